@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "accuracy_sweep.hpp"
+#include "fast_gaussian.hpp"
+#include "fast_math.hpp"
+#include "fast_tanh.hpp"
+#include "fast_trig.hpp"
+#include "reference_table.hpp"
+
+// Exhaustive float32 accuracy of the fast:: kernels. Every float in each
+// target's domain is checked, through the dispatched array kernels where
+// there is one. Run with target names to sweep only those, and -r to take
+// the references from reference_tables output, e.g.
+//   ./accuracy_sweep -r refs exp_correct2 log2_minimax
+
+// Reads the reference out of an mmapped table when one was found, so the
+// sweep itself does no libm calls, and computes it otherwise
+struct sweep_reference {
+    double (*function)(double);
+    const fast::reference_table *table = nullptr;
+
+    double operator()(double x) const {
+        return table ? (*table)(static_cast<float>(x)) : function(x);
+    }
+};
+
+struct sweep_target {
+    const char *name;
+    const char *reference_name; // <directory>/<reference_name>.ref
+    double (*reference)(double);
+    float lo;
+    float hi;
+    std::function<fast::sweep_result(const sweep_reference&, float, float)> sweep;
+};
+
+template<typename Tier>
+fast::sweep_result sweep_exp_tier(const sweep_reference& reference, float lo, float hi) {
+    return fast::sweep_f32(
+        [](std::size_t n, float *y, const float *x) { fast::exp<Tier>(n, y, x); }, reference, lo, hi);
+}
+
+double reference_exp(double x) { return std::exp(x); }
+double reference_gaussian(double t) { return std::exp(-t * t / 2); }
+
+const sweep_target targets[] = {
+    {"exp", "exp", reference_exp, -87.0f, 88.0f, [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32(
+            [](std::size_t n, float *y, const float *x) { fast::exp_f32(n, y, x); }, reference, lo, hi);
+    }},
+    {"exp_interp2", "exp", reference_exp, -87.0f, 88.0f, sweep_exp_tier<fast::exp_tier::interp2>},
+    {"exp_correct1", "exp", reference_exp, -87.0f, 88.0f, sweep_exp_tier<fast::exp_tier::correct1>},
+    {"exp_correct2", "exp", reference_exp, -87.0f, 88.0f, sweep_exp_tier<fast::exp_tier::correct2>},
+    {"exp_correct3", "exp", reference_exp, -87.0f, 88.0f, sweep_exp_tier<fast::exp_tier::correct3>},
+    {"exp_precise", "exp", reference_exp, -87.0f, 88.0f, sweep_exp_tier<fast::exp_tier::precise>},
+    {"log2_minimax", "log2", [](double x) { return std::log2(x); }, 1.17549435e-38f, 3.40282347e+38f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32([](float x) { return fast::log2_minimax(x); }, reference, lo, hi);
+    }},
+    {"tanh", "tanh", [](double x) { return std::tanh(x); }, -10.0f, 10.0f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32(
+            [](std::size_t n, float *y, const float *x) { fast::tanh(n, y, x); }, reference, lo, hi);
+    }},
+    {"atanh", "atanh", [](double x) { return std::atanh(x); }, -0.999f, 0.999f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32(
+            [](std::size_t n, float *y, const float *x) { fast::atanh(n, y, x); }, reference, lo, hi);
+    }},
+    {"sin", "sin", [](double x) { return std::sin(x); }, -1000.0f, 1000.0f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32(
+            [](std::size_t n, float *y, const float *x) { fast::sin(n, y, x); }, reference, lo, hi);
+    }},
+    {"gaussian_refined", "gaussian", reference_gaussian, -13.0f, 13.0f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32([](float t) { return fast::gaussian_refined(t); }, reference, lo, hi);
+    }},
+    {"gaussian_int", "gaussian", reference_gaussian, -13.0f, 13.0f,
+     [](const sweep_reference& reference, float lo, float hi) {
+        return fast::sweep_f32(
+            [](std::size_t n, float *y, const float *t) { fast::gaussian_int({t, n}, {y, n}); }, reference, lo, hi);
+    }},
+};
+
+void run(const sweep_target& target, const char *reference_directory) {
+    // A table only stands in for the reference if it has every input. A
+    // missing table falls back to libm, a broken or mismatched one throws.
+    std::optional<fast::reference_table> table;
+    if (reference_directory) {
+        table = fast::open_reference_table(reference_directory, target.reference_name);
+        if (table && (!table->covers(target.lo) || !table->covers(target.hi))) {
+            table.reset();
+        }
+    }
+    const sweep_reference reference{target.reference, table ? &*table : nullptr};
+
+    auto start = std::chrono::steady_clock::now();
+    fast::sweep_result result = target.sweep(reference, target.lo, target.hi);
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setprecision(4)
+        << target.name << " [" << target.lo << ", " << target.hi << "]: "
+        << result.inputs << " inputs in " << seconds.count() << " s"
+        << (table ? " from table" : "")
+        << "\n  max abs:  " << result.max_abs << " at " << std::setprecision(9) << result.max_abs_input
+        << "\n  max ulp:  " << std::setprecision(4) << result.max_ulp << " at " << std::setprecision(9) << result.max_ulp_input
+        << "\n  max rel:  " << std::setprecision(4) << result.max_rel << " at " << std::setprecision(9) << result.max_rel_input
+        << "\n  mean rel: " << std::setprecision(4) << result.mean_rel();
+    if (result.non_finite) {
+        std::cout << "\n  non-finite: " << result.non_finite;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::cout << "Using " << fast::isa_name(fast::kernels().level) << " kernels, "
+        << fast::thread_pool::global().size() << " threads" << std::endl;
+
+    // -r <directory> reads references from reference_tables output
+    const char *reference_directory = nullptr;
+    std::vector<const char *> names;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            reference_directory = argv[++i];
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+
+    for (const auto& target : targets) {
+        bool selected = names.empty();
+        for (const char *name : names) {
+            selected |= std::strcmp(name, target.name) == 0;
+        }
+        if (selected) {
+            run(target, reference_directory);
+        }
+    }
+    return 0;
+}
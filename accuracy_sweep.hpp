@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace fast {
+
+    // Exhaustive accuracy sweeps: every float32 bit pattern in a range goes
+    // through the approximation and is compared against a double reference.
+    //
+    // The approximation is either an array kernel approx(n, y, x), so the
+    // dispatched SIMD kernels get measured as they run in practice, or a
+    // plain float(float). The reference is double(double).
+    //
+    // Inputs whose reference is NaN or beyond the float range are skipped.
+    // Non-finite approximations of finite references are counted separately
+    // rather than folded into the error stats.
+    struct sweep_result {
+        uint64_t inputs = 0;
+        uint64_t skipped = 0;
+        uint64_t non_finite = 0;
+
+        double max_abs = 0.0;
+        float max_abs_input = 0.0f;
+        double max_ulp = 0.0;
+        float max_ulp_input = 0.0f;
+        double max_rel = 0.0;
+        float max_rel_input = 0.0f;
+        double sum_rel = 0.0;
+        uint64_t rel_count = 0;
+
+        double mean_rel() const { return rel_count ? sum_rel / static_cast<double>(rel_count) : 0.0; }
+
+        void merge(const sweep_result& other) {
+            inputs += other.inputs;
+            skipped += other.skipped;
+            non_finite += other.non_finite;
+            if (other.max_abs > max_abs) {
+                max_abs = other.max_abs;
+                max_abs_input = other.max_abs_input;
+            }
+            if (other.max_ulp > max_ulp) {
+                max_ulp = other.max_ulp;
+                max_ulp_input = other.max_ulp_input;
+            }
+            if (other.max_rel > max_rel) {
+                max_rel = other.max_rel;
+                max_rel_input = other.max_rel_input;
+            }
+            sum_rel += other.sum_rel;
+            rel_count += other.rel_count;
+        }
+    };
+
+    // Spacing of the floats around |r|, denormals included
+    inline double float_ulp(double r) {
+        int64_t exponent = static_cast<int64_t>((std::bit_cast<uint64_t>(r) >> 52) & 0x7FF) - 1023;
+        exponent = std::max<int64_t>(exponent - 23, -149);
+        return std::bit_cast<double>(static_cast<uint64_t>(exponent + 1023) << 52);
+    }
+
+    inline void sweep_accumulate(sweep_result& result, float x, float approx, double reference) {
+        if (std::isnan(reference) || std::fabs(reference) > std::numeric_limits<float>::max()) {
+            ++result.skipped;
+            return;
+        }
+        ++result.inputs;
+        if (!std::isfinite(approx)) {
+            ++result.non_finite;
+            return;
+        }
+
+        const double error = std::fabs(static_cast<double>(approx) - reference);
+        if (error > result.max_abs) {
+            result.max_abs = error;
+            result.max_abs_input = x;
+        }
+        const double ulp = error / float_ulp(reference);
+        if (ulp > result.max_ulp) {
+            result.max_ulp = ulp;
+            result.max_ulp_input = x;
+        }
+        if (reference != 0.0) {
+            const double rel = error / std::fabs(reference);
+            result.sum_rel += rel;
+            ++result.rel_count;
+            if (rel > result.max_rel) {
+                result.max_rel = rel;
+                result.max_rel_input = x;
+            }
+        }
+    }
+
+    // Each task covers sweep_chunk consecutive bit patterns, evaluated
+    // sweep_batch at a time from stack buffers
+    constexpr uint64_t sweep_chunk = uint64_t(1) << 16;
+    constexpr std::size_t sweep_batch = 4096;
+
+    // Sweeps the bit patterns [first, last], both inclusive. Inputs are
+    // ordered by bits, not by value, so a range must not cross from
+    // positive into negative floats, use the float overload for that.
+    template<typename Approx, typename Reference>
+    sweep_result sweep_f32_bits(Approx approx, Reference reference, uint32_t first, uint32_t last,
+                                thread_pool& pool = thread_pool::global()) {
+        const uint64_t count = uint64_t(last) - first + 1;
+        const std::size_t tasks = static_cast<std::size_t>((count + sweep_chunk - 1) / sweep_chunk);
+        std::vector<sweep_result> partial(tasks);
+
+        pool.parallel_for(tasks, [&](std::size_t task) {
+            const uint64_t begin = first + task * sweep_chunk;
+            const uint64_t end = std::min(begin + sweep_chunk, uint64_t(last) + 1);
+            sweep_result& result = partial[task];
+            float x[sweep_batch];
+            float y[sweep_batch];
+
+            for (uint64_t bits = begin; bits < end; bits += sweep_batch) {
+                const std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(sweep_batch, end - bits));
+                for (std::size_t i = 0; i < n; ++i) {
+                    x[i] = std::bit_cast<float>(static_cast<uint32_t>(bits + i));
+                }
+                if constexpr (std::is_invocable_v<Approx&, std::size_t, float *, const float *>) {
+                    approx(n, y, x);
+                } else {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        y[i] = approx(x[i]);
+                    }
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    sweep_accumulate(result, x[i], y[i], reference(static_cast<double>(x[i])));
+                }
+            }
+        });
+
+        sweep_result total;
+        for (const auto& result : partial) {
+            total.merge(result);
+        }
+        return total;
+    }
+
+    // Every float in [lo, hi]. -0.0 and 0.0 are both swept when the range
+    // contains zero.
+    template<typename Approx, typename Reference>
+    sweep_result sweep_f32(Approx approx, Reference reference, float lo, float hi,
+                           thread_pool& pool = thread_pool::global()) {
+        const uint32_t sign = 0x80000000u;
+        sweep_result total;
+        if (lo < 0.0f || std::signbit(lo)) {
+            // Negative bits grow with magnitude, so hi gives the first pattern
+            const float top = hi < 0.0f ? hi : -0.0f;
+            total.merge(sweep_f32_bits(approx, reference,
+                                       std::bit_cast<uint32_t>(top) | sign, std::bit_cast<uint32_t>(lo), pool));
+        }
+        if (hi >= 0.0f && !std::signbit(hi)) {
+            const float bottom = lo > 0.0f ? lo : 0.0f;
+            total.merge(sweep_f32_bits(approx, reference,
+                                       std::bit_cast<uint32_t>(bottom), std::bit_cast<uint32_t>(hi), pool));
+        }
+        return total;
+    }
+
+    // All 2^32 inputs, NaNs and infinities included
+    template<typename Approx, typename Reference>
+    sweep_result sweep_f32(Approx approx, Reference reference, thread_pool& pool = thread_pool::global()) {
+        return sweep_f32_bits(approx, reference, 0u, 0xFFFFFFFFu, pool);
+    }
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <vector>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "fast_divide.hpp"
+
+template<typename T>
+std::vector<T> generate_random_ints(size_t size, uint64_t min, uint64_t max) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<uint64_t> dis(min, max);
+
+    std::vector<T> data(size);
+    for (auto& val : data) {
+        val = static_cast<T>(dis(gen));
+    }
+    return data;
+}
+
+std::vector<uint8_t> generate_random_bytes(size_t size, int min, int max) {
+    return generate_random_ints<uint8_t>(size, min, max);
+}
+
+// Runs a kernel of the form kernel(n, q, a, b) on random numerators and
+// non-zero divisors
+template<typename T, typename Kernel>
+static void run_divide(benchmark::State& state, Kernel kernel) {
+    const size_t size = state.range(0);
+    const uint64_t max = std::numeric_limits<T>::max();
+    auto a = generate_random_ints<T>(size, 0, max);
+    auto b = generate_random_ints<T>(size, 1, max);
+    std::vector<T> q(size);
+
+    for (auto _ : state) {
+        kernel(size, q.data(), a.data(), b.data());
+        benchmark::DoNotOptimize(q.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetBytesProcessed(state.iterations() * size * 3 * sizeof(T));
+}
+
+template<typename Kernel>
+static void run_divide_u8(benchmark::State& state, Kernel kernel) {
+    run_divide<uint8_t>(state, kernel);
+}
+
+/* ---------------------------- u8 / u8 ---------------------------- */
+
+static void BM_DivideU8Std(benchmark::State& state) {
+    run_divide_u8(state, [](size_t n, uint8_t *q, const uint8_t *a, const uint8_t *b) {
+        for (size_t i = 0; i < n; i++) {
+            q[i] = a[i] / b[i];
+        }
+    });
+}
+
+static void BM_DivideU8Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_divide_u8(state, [](size_t n, uint8_t *q, const uint8_t *a, const uint8_t *b) {
+        fast::avx2_divide_u8(n, q, a, b);
+    });
+}
+
+BENCHMARK(BM_DivideU8Std)->Range(64, 1<<20);
+BENCHMARK(BM_DivideU8Avx2)->Range(64, 1<<20);
+
+/* ------------------------ u16 / u16, u32 / u32 ------------------------ */
+
+static void BM_DivideU16Std(benchmark::State& state) {
+    run_divide<uint16_t>(state, [](size_t n, uint16_t *q, const uint16_t *a, const uint16_t *b) {
+        for (size_t i = 0; i < n; i++) {
+            q[i] = a[i] / b[i];
+        }
+    });
+}
+
+static void BM_DivideU16Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_divide<uint16_t>(state, [](size_t n, uint16_t *q, const uint16_t *a, const uint16_t *b) {
+        fast::avx2_divide_u16(n, q, a, b);
+    });
+}
+
+static void BM_DivideU32Std(benchmark::State& state) {
+    run_divide<uint32_t>(state, [](size_t n, uint32_t *q, const uint32_t *a, const uint32_t *b) {
+        for (size_t i = 0; i < n; i++) {
+            q[i] = a[i] / b[i];
+        }
+    });
+}
+
+static void BM_DivideU32Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_divide<uint32_t>(state, [](size_t n, uint32_t *q, const uint32_t *a, const uint32_t *b) {
+        fast::avx2_divide_u32(n, q, a, b);
+    });
+}
+
+BENCHMARK(BM_DivideU16Std)->Range(64, 1<<20);
+BENCHMARK(BM_DivideU16Avx2)->Range(64, 1<<20);
+BENCHMARK(BM_DivideU32Std)->Range(64, 1<<20);
+BENCHMARK(BM_DivideU32Avx2)->Range(64, 1<<20);
+
+/* ------------------------ u8 / constant ------------------------ */
+
+// The divisor comes from the range argument so the compiler can't fold it
+template<typename Kernel>
+static void run_divide_u8_constant(benchmark::State& state, Kernel kernel) {
+    const size_t size = state.range(0);
+    const uint8_t divisor = static_cast<uint8_t>(state.range(1));
+    auto a = generate_random_bytes(size, 0, 255);
+    std::vector<uint8_t> q(size);
+
+    for (auto _ : state) {
+        kernel(size, q.data(), a.data(), divisor);
+        benchmark::DoNotOptimize(q.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetBytesProcessed(state.iterations() * size * 2);
+}
+
+// Bandwidth ceiling for the constant divisor kernels
+static void BM_CopyU8(benchmark::State& state) {
+    run_divide_u8_constant(state, [](size_t n, uint8_t *q, const uint8_t *a, uint8_t) {
+        std::memcpy(q, a, n);
+    });
+}
+
+static void BM_DivideU8ConstantStd(benchmark::State& state) {
+    run_divide_u8_constant(state, [](size_t n, uint8_t *q, const uint8_t *a, uint8_t divisor) {
+        for (size_t i = 0; i < n; i++) {
+            q[i] = a[i] / divisor;
+        }
+    });
+}
+
+static void BM_DividerU8Scalar(benchmark::State& state) {
+    run_divide_u8_constant(state, [](size_t n, uint8_t *q, const uint8_t *a, uint8_t divisor) {
+        fast::scalar_divide_u8(n, q, a, fast::divider_u8(divisor));
+    });
+}
+
+static void BM_DividerU8Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_divide_u8_constant(state, [](size_t n, uint8_t *q, const uint8_t *a, uint8_t divisor) {
+        fast::avx2_divide_u8(n, q, a, fast::divider_u8(divisor));
+    });
+}
+
+BENCHMARK(BM_CopyU8)->ArgsProduct({benchmark::CreateRange(4<<10, 16<<20, 16), {3}});
+BENCHMARK(BM_DivideU8ConstantStd)->ArgsProduct({benchmark::CreateRange(4<<10, 16<<20, 16), {3}});
+BENCHMARK(BM_DividerU8Scalar)->ArgsProduct({benchmark::CreateRange(4<<10, 16<<20, 16), {3}});
+BENCHMARK(BM_DividerU8Avx2)->ArgsProduct({benchmark::CreateRange(4<<10, 16<<20, 16), {3}});
+
+/* ------------------------------ RGBA8 ------------------------------ */
+
+constexpr size_t frame_4k_pixels = 3840 * 2160;
+
+// Random premultiplied pixels, c <= a, with about 1 in 16 fully transparent
+std::vector<uint8_t> generate_premultiplied_rgba8(size_t pixels) {
+    std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<int> dis(0, 255);
+    std::vector<uint8_t> data(4 * pixels);
+    for (size_t i = 0; i < 4 * pixels; i += 4) {
+        const int a = dis(gen) < 16 ? 0 : dis(gen);
+        for (size_t c = 0; c < 3; c++) {
+            data[i + c] = static_cast<uint8_t>(dis(gen) * a / 255);
+        }
+        data[i + 3] = static_cast<uint8_t>(a);
+    }
+    return data;
+}
+
+template<typename Kernel>
+static void run_unpremultiply(benchmark::State& state, Kernel kernel) {
+    const size_t pixels = frame_4k_pixels;
+    auto in = generate_premultiplied_rgba8(pixels);
+    std::vector<uint8_t> out(4 * pixels);
+
+    for (auto _ : state) {
+        kernel(pixels, out.data(), in.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * pixels);
+    state.SetBytesProcessed(state.iterations() * pixels * 8);
+}
+
+template<typename Kernel>
+static void run_divide_blend(benchmark::State& state, Kernel kernel) {
+    const size_t pixels = frame_4k_pixels;
+    auto base = generate_random_bytes(4 * pixels, 0, 255);
+    auto blend = generate_random_bytes(4 * pixels, 0, 255);
+    std::vector<uint8_t> out(4 * pixels);
+
+    for (auto _ : state) {
+        kernel(pixels, out.data(), base.data(), blend.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * pixels);
+    state.SetBytesProcessed(state.iterations() * pixels * 12);
+}
+
+static void BM_UnpremultiplyRgba8Std(benchmark::State& state) {
+    run_unpremultiply(state, [](size_t n, uint8_t *out, const uint8_t *in) {
+        for (size_t i = 0; i < 4 * n; i += 4) {
+            const int a = in[i + 3];
+            for (size_t c = 0; c < 3; c++) {
+                out[i + c] = a ? static_cast<uint8_t>(std::min(in[i + c] * 255 / a, 255)) : 0;
+            }
+            out[i + 3] = static_cast<uint8_t>(a);
+        }
+    });
+}
+
+static void BM_UnpremultiplyRgba8Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unpremultiply(state, [](size_t n, uint8_t *out, const uint8_t *in) {
+        fast::avx2_unpremultiply_rgba8(n, out, in);
+    });
+}
+
+static void BM_DivideBlendRgba8Std(benchmark::State& state) {
+    run_divide_blend(state, [](size_t n, uint8_t *out, const uint8_t *base, const uint8_t *blend) {
+        for (size_t i = 0; i < 4 * n; i += 4) {
+            for (size_t c = 0; c < 3; c++) {
+                out[i + c] = blend[i + c] ? static_cast<uint8_t>(std::min(base[i + c] * 255 / blend[i + c], 255)) : 255;
+            }
+            out[i + 3] = base[i + 3];
+        }
+    });
+}
+
+static void BM_DivideBlendRgba8Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_divide_blend(state, [](size_t n, uint8_t *out, const uint8_t *base, const uint8_t *blend) {
+        fast::avx2_divide_blend_rgba8(n, out, base, blend);
+    });
+}
+
+BENCHMARK(BM_UnpremultiplyRgba8Std)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_UnpremultiplyRgba8Avx2)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DivideBlendRgba8Std)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DivideBlendRgba8Avx2)->Unit(benchmark::kMillisecond);
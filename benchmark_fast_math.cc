@@ -0,0 +1,485 @@
+#include <cmath>
+#include <cstdint>
+
+#include <vector>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "fast_math.hpp"
+#include "fast_gaussian.hpp"
+#include "fast_pow.hpp"
+#include "fast_tanh.hpp"
+#include "fast_trig.hpp"
+#include "lut_interp.hpp"
+
+std::vector<float> generate_random_data(size_t size, float min, float max) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<float> dis(min, max);
+
+    std::vector<float> data(size);
+    for (auto& val : data) {
+        val = dis(gen);
+    }
+    return data;
+}
+
+// Runs an array kernel of the form kernel(n, y, x) over inputs in [min, max)
+template<typename Kernel>
+static void run_unary(benchmark::State& state, Kernel kernel, float min, float max) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size, min, max);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        kernel(size, output.data(), input.data());
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+/* ----------------------------- log ----------------------------- */
+
+static void BM_LogStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = logf(x[i]);
+        }
+    }, 1e-3f, 1e4f);
+}
+
+static void BM_LogScalar(benchmark::State& state) {
+    run_unary(state, fast::scalar_log_f32, 1e-3f, 1e4f);
+}
+
+static void BM_LogAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_log_f32(n, y, x); }, 1e-3f, 1e4f);
+}
+
+static void BM_WeirdLogAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_weird_log_f32(n, y, x); }, 1e-3f, 1e4f);
+}
+
+static void BM_Log2Interp2Scalar(benchmark::State& state) {
+    run_unary(state, fast::scalar_log2_interp2_f32, 1e-3f, 1e4f);
+}
+
+static void BM_Log2Interp2Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_log2_interp2_f32(n, y, x); }, 1e-3f, 1e4f);
+}
+
+BENCHMARK(BM_LogStd)->Range(64, 64<<10);
+BENCHMARK(BM_LogScalar)->Range(64, 64<<10);
+BENCHMARK(BM_LogAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_WeirdLogAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_Log2Interp2Scalar)->Range(64, 64<<10);
+BENCHMARK(BM_Log2Interp2Avx2)->Range(64, 64<<10);
+
+/* ----------------------------- exp ----------------------------- */
+
+static void BM_ExpStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = expf(x[i]);
+        }
+    }, -80.0f, 80.0f);
+}
+
+static void BM_ExpAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_exp_f32(n, y, x); }, -80.0f, 80.0f);
+}
+
+static void BM_ExpInterp2Scalar(benchmark::State& state) {
+    run_unary(state, fast::scalar_exp_interp2_f32, -80.0f, 80.0f);
+}
+
+static void BM_ExpInterp2Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_exp_interp2_f32(n, y, x); }, -80.0f, 80.0f);
+}
+
+template<typename Tier>
+static void BM_ExpTierScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = fast::exp<Tier>(x[i]);
+        }
+    }, -80.0f, 80.0f);
+}
+
+template<typename Tier>
+static void BM_ExpTierAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_exp_f32<Tier>(n, y, x); }, -80.0f, 80.0f);
+}
+
+template<typename Tier>
+static void BM_ExpTierAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx512_exp_f32<Tier>(n, y, x); }, -80.0f, 80.0f);
+}
+
+BENCHMARK(BM_ExpStd)->Range(64, 64<<10);
+BENCHMARK(BM_ExpAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_ExpInterp2Scalar)->Range(64, 64<<10);
+BENCHMARK(BM_ExpInterp2Avx2)->Range(64, 64<<10);
+
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::schraudolph>)->Arg(4096);
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::interp2>)->Arg(4096);
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::correct1>)->Arg(4096);
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::correct2>)->Arg(4096);
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::correct3>)->Arg(4096);
+BENCHMARK(BM_ExpTierScalar<fast::exp_tier::precise>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::schraudolph>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::interp2>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::correct1>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::correct2>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::correct3>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx2<fast::exp_tier::precise>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::schraudolph>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::interp2>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::correct1>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::correct2>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::correct3>)->Arg(4096);
+BENCHMARK(BM_ExpTierAvx512<fast::exp_tier::precise>)->Arg(4096);
+
+/* ----------------------------- tanh ----------------------------- */
+
+static void BM_TanhStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = tanhf(x[i]);
+        }
+    }, -5.0f, 5.0f);
+}
+
+static void BM_TanhScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::scalar_tanh_f32(n, y, x); }, -5.0f, 5.0f);
+}
+
+static void BM_TanhAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_tanh_f32(n, y, x); }, -5.0f, 5.0f);
+}
+
+static void BM_TanhSchraudolphAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::avx2_tanh_f32<fast::exp_tier::schraudolph>(n, y, x);
+    }, -5.0f, 5.0f);
+}
+
+static void BM_AtanhStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = atanhf(x[i]);
+        }
+    }, -0.99f, 0.99f);
+}
+
+static void BM_AtanhScalar(benchmark::State& state) {
+    run_unary(state, fast::scalar_atanh_f32, -0.99f, 0.99f);
+}
+
+static void BM_AtanhAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_atanh_f32(n, y, x); }, -0.99f, 0.99f);
+}
+
+BENCHMARK(BM_TanhStd)->Range(64, 64<<10);
+BENCHMARK(BM_TanhScalar)->Range(64, 64<<10);
+BENCHMARK(BM_TanhAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_TanhSchraudolphAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_AtanhStd)->Range(64, 64<<10);
+BENCHMARK(BM_AtanhScalar)->Range(64, 64<<10);
+BENCHMARK(BM_AtanhAvx2)->Range(64, 64<<10);
+
+/* ----------------------------- trig ----------------------------- */
+
+static void BM_SinStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = sinf(x[i]);
+        }
+    }, -100.0f, 100.0f);
+}
+
+static void BM_SinScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::scalar_sin_f32(n, y, x); }, -100.0f, 100.0f);
+}
+
+static void BM_SinAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_sin_f32(n, y, x); }, -100.0f, 100.0f);
+}
+
+static void BM_SinBits4Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_sin_f32<4>(n, y, x); }, -100.0f, 100.0f);
+}
+
+static void BM_CosAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_cos_f32(n, y, x); }, -100.0f, 100.0f);
+}
+
+// Two outputs, so these don't fit run_unary
+template<typename Kernel>
+static void run_sincos(benchmark::State& state, Kernel kernel) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size, -100.0f, 100.0f);
+    std::vector<float> s(size), c(size);
+
+    for (auto _ : state) {
+        kernel(size, s.data(), c.data(), input.data());
+        benchmark::DoNotOptimize(s.data());
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SincosStd(benchmark::State& state) {
+    run_sincos(state, [](size_t n, float *s, float *c, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            sincosf(x[i], &s[i], &c[i]);
+        }
+    });
+}
+
+static void BM_SincosAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_sincos(state, [](size_t n, float *s, float *c, const float *x) { fast::avx2_sincos_f32(n, s, c, x); });
+}
+
+BENCHMARK(BM_SinStd)->Range(64, 64<<10);
+BENCHMARK(BM_SinScalar)->Range(64, 64<<10);
+BENCHMARK(BM_SinAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_SinBits4Avx2)->Range(64, 64<<10);
+BENCHMARK(BM_CosAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_SincosStd)->Range(64, 64<<10);
+BENCHMARK(BM_SincosAvx2)->Range(64, 64<<10);
+
+/* ----------------------------- pow ----------------------------- */
+
+// Gamma correction: every pixel in [0, 1] raised to one fixed exponent.
+// 2.2 rather than 1/2.2 because the LUT only covers y in [0.5, 4].
+constexpr float gamma_exponent = 2.2f;
+
+static void BM_GammaStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            y[i] = powf(x[i], gamma_exponent);
+        }
+    }, 0.0f, 1.0f);
+}
+
+static void BM_GammaPowLutScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::scalar_pow_lut_f32(n, y, x, gamma_exponent); }, 0.0f, 1.0f);
+}
+
+static void BM_GammaPowLutAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_pow_lut_f32(n, y, x, gamma_exponent); }, 0.0f, 1.0f);
+}
+
+static void BM_GammaPowLogExpScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::scalar_pow_logexp_f32(n, y, x, gamma_exponent); }, 0.0f, 1.0f);
+}
+
+static void BM_GammaPowLogExpAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_pow_logexp_f32(n, y, x, gamma_exponent); }, 0.0f, 1.0f);
+}
+
+// 1080p single channel on top of the usual range
+BENCHMARK(BM_GammaStd)->Range(64, 64<<10)->Arg(1920 * 1080);
+BENCHMARK(BM_GammaPowLutScalar)->Range(64, 64<<10)->Arg(1920 * 1080);
+BENCHMARK(BM_GammaPowLutAvx2)->Range(64, 64<<10)->Arg(1920 * 1080);
+BENCHMARK(BM_GammaPowLogExpScalar)->Range(64, 64<<10)->Arg(1920 * 1080);
+BENCHMARK(BM_GammaPowLogExpAvx2)->Range(64, 64<<10)->Arg(1920 * 1080);
+
+/* --------------------------- gaussian --------------------------- */
+
+constexpr float gaussian_mu = 0.5f;
+constexpr float gaussian_sigma = 1.5f;
+
+static void BM_GaussianStd(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        for (size_t i = 0; i < n; i++) {
+            float t = (x[i] - gaussian_mu) / gaussian_sigma;
+            y[i] = expf(-0.5f * t * t);
+        }
+    }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianScalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::scalar_gaussian_f32(n, y, x, gaussian_mu, gaussian_sigma);
+    }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::avx2_gaussian_f32(n, y, x, gaussian_mu, gaussian_sigma);
+    }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::avx512_gaussian_f32(n, y, x, gaussian_mu, gaussian_sigma);
+    }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianRefinedAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::avx2_gaussian_f32<true>(n, y, x, gaussian_mu, gaussian_sigma);
+    }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianRefinedAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) {
+        fast::avx512_gaussian_f32<true>(n, y, x, gaussian_mu, gaussian_sigma);
+    }, -5.0f, 5.0f);
+}
+
+// Integer-only kernels take t directly
+static void BM_GaussianIntScalar(benchmark::State& state) {
+    run_unary(state, fast::scalar_gaussian_int_f32, -5.0f, 5.0f);
+}
+
+static void BM_GaussianIntAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx2_gaussian_int_f32(n, y, x); }, -5.0f, 5.0f);
+}
+
+static void BM_GaussianIntAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { fast::avx512_gaussian_int_f32(n, y, x); }, -5.0f, 5.0f);
+}
+
+BENCHMARK(BM_GaussianStd)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianScalar)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianAvx512)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianRefinedAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianRefinedAvx512)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianIntScalar)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianIntAvx2)->Range(64, 64<<10);
+BENCHMARK(BM_GaussianIntAvx512)->Range(64, 64<<10);
+
+/* ----------------------------- LUT ----------------------------- */
+
+// 4 segments fit in a ymm and use vpermps, 16 segments need a gather
+using log2_lut_2bit = fast::lut_interp<decltype([](double x) {
+    return fast::cmath::log2(x);
+}), 2, fast::domain<1.0, 2.0>>;
+
+using sin_lut_4bit = fast::lut_interp<decltype([](double x) {
+    return fast::cmath::sin(x * fast::cmath::pi / 2);
+}), 4, fast::domain<0.0, 1.0>>;
+
+static void BM_LutLog2Bits2Scalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { log2_lut_2bit::eval(n, y, x); }, 1.0f, 2.0f);
+}
+
+static void BM_LutLog2Bits2Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { log2_lut_2bit::eval_avx2(n, y, x); }, 1.0f, 2.0f);
+}
+
+static void BM_LutSinBits4Scalar(benchmark::State& state) {
+    run_unary(state, [](size_t n, float *y, const float *x) { sin_lut_4bit::eval(n, y, x); }, 0.0f, 1.0f);
+}
+
+static void BM_LutSinBits4Avx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    run_unary(state, [](size_t n, float *y, const float *x) { sin_lut_4bit::eval_avx2(n, y, x); }, 0.0f, 1.0f);
+}
+
+BENCHMARK(BM_LutLog2Bits2Scalar)->Range(64, 64<<10);
+BENCHMARK(BM_LutLog2Bits2Avx2)->Range(64, 64<<10);
+BENCHMARK(BM_LutSinBits4Scalar)->Range(64, 64<<10);
+BENCHMARK(BM_LutSinBits4Avx2)->Range(64, 64<<10);
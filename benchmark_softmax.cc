@@ -9,61 +9,7 @@
 
 #include <benchmark/benchmark.h>
 
-#include <immintrin.h>
-
-#if defined(__clang__)
-#pragma clang attribute push (__attribute__((target("avx,avx2,fma"))), apply_to=function)
-#endif
-namespace fast {
-
-    float exp(float x) {
-        //float magic = 214760456192.0f; // more accurate for large values, loses significant precision for small values
-        float magic = 12101628.0f; // approx. (2^23) * log2(e)
-        float integer_1 = 0x7f800000; // 1.0f, converted to a float (1.0 * (255 * 2^23))
-        return std::bit_cast<float>((int32_t)(std::fma(magic, x, integer_1)));
-    }
-
-    __m256 avx2_exp_f32(__m256 x) {
-        const __m256 magic = _mm256_set1_ps(12102203.2f);
-        const __m256 offset = _mm256_set1_ps(0x3f800000);
-
-        return _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_fmadd_ps(magic, x, offset)));
-        return x;
-    }
-
-
-    float avx2_softmax_f32(const std::size_t n, float *y, float *x, float max) {
-        std::size_t i = 0;
-        float sum = 0;
-        // We have a full 256 bit lane available
-        for(; i + 7 < n; i += 8) {
-            __m256 val = avx2_exp_f32(_mm256_sub_ps(_mm256_loadu_ps(x+i), _mm256_set1_ps(max)));
-            _mm256_storeu_ps(y + i, val);
-
-            // _mm256_reduce_add_ps() doesn't exist, so instead extract the results
-            // 128 bits at a time
-            __m128 val2 = _mm_add_ps(_mm256_extractf128_ps(val, 1),
-                                    _mm256_castps256_ps128(val));
-            val2 = _mm_add_ps(val2, _mm_movehl_ps(val2, val2));
-            val2 = _mm_add_ss(val2, _mm_movehdup_ps(val2));
-            sum += (float)_mm_cvtss_f32(val2);
-        }
-
-        for (; i < n; ++i) {
-            float val = fast::exp(x[i] - max);
-            sum += val;
-            y[i] = val;
-        }
-
-        return sum;
-    }
-
-    float vec_softmax(std::vector<float> input) {
-        auto max_val = *std::max_element(input.begin(), input.end());
-        decltype(input) output(input.size());
-        return fast::avx2_softmax_f32(input.size(), output.data(), input.data(), max_val);
-    }
-}
+#include "fast_math.hpp"
 
 float softmax(std::vector<float>& input) {
     auto max_val = *std::max_element(input.begin(), input.end());
@@ -81,9 +27,6 @@ float softmax(std::vector<float>& input) {
 
     return sum;
 }
-#if defined(__clang__)
-#pragma clang attribute pop
-#endif
 
 std::vector<float> generate_random_data(size_t size) {
     std::random_device rd;
@@ -111,9 +54,140 @@ static void BM_SoftmaxOptimized(benchmark::State& state) {
     const size_t size = state.range(0);
     auto input = generate_random_data(size);
 
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fast::softmax(size, output.data(), input.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_LogSoftmaxBasic(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        fast::softmax(size, output.data(), input.data());
+        for (auto& val : output) {
+            val = std::log(val);
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_LogSoftmax(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fast::log_softmax(size, output.data(), input.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SoftmaxInterp2(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fast::softmax_interp2(size, output.data(), input.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SoftmaxOnline(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+
+    for (auto _ : state) {
+        fast::online_softmax online;
+        online.update(size, input.data());
+        benchmark::DoNotOptimize(online.sum());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SoftmaxRows(benchmark::State& state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    fast::thread_pool pool(state.range(2));
+    auto input = generate_random_data(rows * cols);
+    std::vector<float> output(rows * cols);
+
+    for (auto _ : state) {
+        fast::softmax_rows(rows, cols, cols, input.data(), output.data(), pool);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+
+static void BM_SoftmaxAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        auto max_val = *std::max_element(input.begin(), input.end());
+        benchmark::DoNotOptimize(fast::avx512_softmax_f32(size, output.data(), input.data(), max_val));
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_ExpAvx2(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx2)) {
+        state.SkipWithError("AVX2 not supported on this host");
+        return;
+    }
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        fast::avx2_exp_f32(size, output.data(), input.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_ExpAvx512(benchmark::State& state) {
+    if (!fast::isa_supported(fast::isa::avx512)) {
+        state.SkipWithError("AVX-512 not supported on this host");
+        return;
+    }
+    const size_t size = state.range(0);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+
+    for (auto _ : state) {
+        fast::avx512_exp_f32(size, output.data(), input.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SoftmaxIsa(benchmark::State& state) {
+    const size_t size = state.range(0);
+    const auto level = static_cast<fast::isa>(state.range(1));
+    if (!fast::isa_supported(level)) {
+        state.SkipWithError("ISA not supported on this host");
+        return;
+    }
+    const auto kernels = fast::make_kernel_table(level);
+    auto input = generate_random_data(size);
+    std::vector<float> output(size);
+    state.SetLabel(fast::isa_name(level));
+
     for (auto _ : state) {
-        auto input_copy = input;
-        benchmark::DoNotOptimize(fast::vec_softmax(input_copy));
+        auto max_val = *std::max_element(input.begin(), input.end());
+        benchmark::DoNotOptimize(kernels.softmax_f32(size, output.data(), input.data(), max_val));
     }
     state.SetItemsProcessed(state.iterations() * size);
 }
@@ -126,4 +200,54 @@ BENCHMARK(BM_SoftmaxBasic)
 BENCHMARK(BM_SoftmaxOptimized)
     ->RangeMultiplier(2)
     ->Range(8, 8<<10)
-    ->Unit(benchmark::kMicrosecond);
\ No newline at end of file
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_SoftmaxInterp2)
+    ->RangeMultiplier(2)
+    ->Range(8, 8<<10)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_LogSoftmaxBasic)
+    ->RangeMultiplier(8)
+    ->Range(8, 8<<10)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_LogSoftmax)
+    ->RangeMultiplier(8)
+    ->Range(8, 8<<10)
+    ->Unit(benchmark::kMicrosecond);
+
+// Sum only, compare against the first two passes of BM_SoftmaxOptimized
+BENCHMARK(BM_SoftmaxOnline)
+    ->RangeMultiplier(8)
+    ->Range(8, 8<<20)
+    ->Unit(benchmark::kMicrosecond);
+
+// rows x cols x threads
+BENCHMARK(BM_SoftmaxRows)
+    ->ArgsProduct({{64, 1024, 8192}, {64, 512, 4096}, {1, 2, 4, 8}})
+    ->ArgNames({"rows", "cols", "threads"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Odd lengths exercise the masked tail, 50257 is a GPT-2 vocab row
+BENCHMARK(BM_SoftmaxAvx512)
+    ->RangeMultiplier(2)
+    ->Range(8, 8<<10)
+    ->Arg(15)->Arg(1023)->Arg(50257)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_ExpAvx2)
+    ->Arg(15)->Arg(1023)->Arg(8<<10)->Arg(50257)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_ExpAvx512)
+    ->Arg(15)->Arg(1023)->Arg(8<<10)->Arg(50257)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_SoftmaxIsa)
+    ->ArgsProduct({
+        benchmark::CreateRange(8, 8<<10, 8),
+        {static_cast<int64_t>(fast::isa::scalar), static_cast<int64_t>(fast::isa::sse41),
+         static_cast<int64_t>(fast::isa::avx2), static_cast<int64_t>(fast::isa::avx512)}})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,65 @@
+#pragma once
+
+namespace fast {
+
+    // <cmath> isn't constexpr until C++26, these are only used to build
+    // tables at compile time so they favour accuracy over speed
+    namespace cmath {
+        constexpr double pi = 3.14159265358979323846;
+        constexpr double ln2 = 0.69314718055994530942;
+
+        constexpr double exp(double x) {
+            // e^x = 2^k * e^r with |r| <= ln(2)/2
+            long k = static_cast<long>(x / ln2 + (x < 0 ? -0.5 : 0.5));
+            double r = x - k * ln2;
+            double term = 1.0;
+            double sum = 1.0;
+            for (int i = 1; i < 30; ++i) {
+                term *= r / i;
+                sum += term;
+            }
+            for (; k > 0; --k) sum *= 2.0;
+            for (; k < 0; ++k) sum *= 0.5;
+            return sum;
+        }
+
+        constexpr double log(double x) {
+            // x = 2^k * m with m in [1, 2), then log(m) = 2 atanh((m - 1) / (m + 1))
+            int k = 0;
+            for (; x >= 2.0; x *= 0.5) ++k;
+            for (; x < 1.0; x *= 2.0) --k;
+            double z = (x - 1.0) / (x + 1.0);
+            double z2 = z * z;
+            double term = z;
+            double sum = 0.0;
+            for (int i = 1; i < 80; i += 2) {
+                sum += term / i;
+                term *= z2;
+            }
+            return 2.0 * sum + k * ln2;
+        }
+
+        constexpr double log2(double x) { return log(x) / ln2; }
+        constexpr double exp2(double x) { return exp(x * ln2); }
+
+        constexpr double sin(double x) {
+            // Reduce to [-pi, pi]
+            long k = static_cast<long>(x / (2 * pi) + (x < 0 ? -0.5 : 0.5));
+            x -= k * 2 * pi;
+            double term = x;
+            double sum = x;
+            for (int i = 1; i < 30; ++i) {
+                term *= -x * x / ((2 * i) * (2 * i + 1));
+                sum += term;
+            }
+            return sum;
+        }
+
+        constexpr double cos(double x) { return sin(x + pi / 2); }
+
+        constexpr double tanh(double x) {
+            double e2x = exp(2 * x);
+            return (e2x - 1) / (e2x + 1);
+        }
+    }
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+
+namespace fast {
+
+    // Exact u8 / u8 division, q[i] = a[i] / b[i]. Division by zero gives 0,
+    // which is what correct_int_divide in u8_divide.cc ends up with on x86.
+    inline void scalar_divide_u8(const std::size_t n, uint8_t *q, const uint8_t *a, const uint8_t *b) {
+        for (std::size_t i = 0; i < n; ++i) {
+            q[i] = b[i] ? a[i] / b[i] : 0;
+        }
+    }
+
+    // Saturates four groups of 8 epi32 lanes back down to 32 bytes in order.
+    // The packs work per 128-bit lane, so each lane ends up holding 4 bytes
+    // from every group, the permute puts the dwords back in order.
+    FAST_TARGET_AVX2 inline __m256i avx2_pack_u8(__m256i q0, __m256i q1, __m256i q2, __m256i q3) {
+        __m256i q = _mm256_packus_epi16(_mm256_packus_epi32(q0, q1), _mm256_packus_epi32(q2, q3));
+        return _mm256_permutevar8x32_epi32(q, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    // (a + 0.5) * rcp(b), truncated. Every a / b is either an integer or at
+    // least 1/b below the next one, so the half keeps exact quotients off
+    // the rounding edge while staying 0.5/b >= 1/510 below the next
+    // integer, and the ~2^-22 rcp error moves the product by at most ~6e-5.
+    // b = 0 gives NaN, which converts to 0x80000000 and packs to 0.
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_u8_epi32(__m256i a, __m256i b) {
+        __m256 numerator = _mm256_add_ps(_mm256_cvtepi32_ps(a), _mm256_set1_ps(0.5f));
+        __m256 reciprocal = avx2_rcp_f32(_mm256_cvtepi32_ps(b));
+        return _mm256_cvttps_epi32(_mm256_mul_ps(numerator, reciprocal));
+    }
+
+    // Divides 32 u8 lanes by 32 u8 lanes, four groups of 8 widened to floats
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_u8(__m256i a, __m256i b) {
+        __m128i a_lo = _mm256_castsi256_si128(a);
+        __m128i a_hi = _mm256_extracti128_si256(a, 1);
+        __m128i b_lo = _mm256_castsi256_si128(b);
+        __m128i b_hi = _mm256_extracti128_si256(b, 1);
+
+        __m256i q0 = avx2_divide_u8_epi32(_mm256_cvtepu8_epi32(a_lo), _mm256_cvtepu8_epi32(b_lo));
+        __m256i q1 = avx2_divide_u8_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(a_lo, 8)),
+                                          _mm256_cvtepu8_epi32(_mm_srli_si128(b_lo, 8)));
+        __m256i q2 = avx2_divide_u8_epi32(_mm256_cvtepu8_epi32(a_hi), _mm256_cvtepu8_epi32(b_hi));
+        __m256i q3 = avx2_divide_u8_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(a_hi, 8)),
+                                          _mm256_cvtepu8_epi32(_mm_srli_si128(b_hi, 8)));
+
+        return avx2_pack_u8(q0, q1, q2, q3);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_divide_u8(const std::size_t n, uint8_t *q, const uint8_t *a, const uint8_t *b) {
+        std::size_t i = 0;
+        for (; i + 31 < n; i += 32) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i), avx2_divide_u8(va, vb));
+        }
+        scalar_divide_u8(n - i, q + i, a + i, b + i);
+    }
+
+    inline void divide_u8(const std::size_t n, uint8_t *q, const uint8_t *a, const uint8_t *b) {
+        if (kernels().level >= isa::avx2) {
+            avx2_divide_u8(n, q, a, b);
+        } else {
+            scalar_divide_u8(n, q, a, b);
+        }
+    }
+
+    /* ---------------------------- u16 / u32 ---------------------------- */
+
+    inline void scalar_divide_u16(const std::size_t n, uint16_t *q, const uint16_t *a, const uint16_t *b) {
+        for (std::size_t i = 0; i < n; ++i) {
+            q[i] = b[i] ? a[i] / b[i] : 0;
+        }
+    }
+
+    inline void scalar_divide_u32(const std::size_t n, uint32_t *q, const uint32_t *a, const uint32_t *b) {
+        for (std::size_t i = 0; i < n; ++i) {
+            q[i] = b[i] ? a[i] / b[i] : 0;
+        }
+    }
+
+    // The u8 trick runs out of margin for 16-bit operands (the next integer
+    // can be 1/65535 away), so the reciprocal quotient is only taken as a
+    // first guess. rcp is good to ~22 bits, so a * rcp(b) is within 0.02 of
+    // a / b and the truncated guess is off by at most one either way. The
+    // remainder a - q * b fits easily in 32 bits and says which way.
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_u16_epi32(__m256i a, __m256i b) {
+        __m256 reciprocal = avx2_rcp_f32(_mm256_cvtepi32_ps(b));
+        __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(a), reciprocal));
+
+        // The compares give -1 where true
+        __m256i r = _mm256_sub_epi32(a, _mm256_mullo_epi32(q, b));
+        q = _mm256_add_epi32(q, _mm256_cmpgt_epi32(_mm256_setzero_si256(), r));
+        q = _mm256_sub_epi32(q, _mm256_cmpgt_epi32(r, _mm256_sub_epi32(b, _mm256_set1_epi32(1))));
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(b, _mm256_setzero_si256()), q);
+    }
+
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_u16(__m256i a, __m256i b) {
+        __m256i q0 = avx2_divide_u16_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(a)),
+                                           _mm256_cvtepu16_epi32(_mm256_castsi256_si128(b)));
+        __m256i q1 = avx2_divide_u16_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(a, 1)),
+                                           _mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1)));
+        return _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    // AVX2 only converts signed ints, so bias through the sign bit
+    FAST_TARGET_AVX2 inline __m256d avx2_cvtepu32_pd(__m128i x) {
+        __m256d biased = _mm256_cvtepi32_pd(_mm_xor_si128(x, _mm_set1_epi32(INT32_MIN)));
+        return _mm256_add_pd(biased, _mm256_set1_pd(2147483648.0));
+    }
+
+    // x must already be a whole number in [0, 2^32)
+    FAST_TARGET_AVX2 inline __m128i avx2_cvtpd_epu32(__m256d x) {
+        __m128i biased = _mm256_cvttpd_epi32(_mm256_sub_pd(x, _mm256_set1_pd(2147483648.0)));
+        return _mm_xor_si128(biased, _mm_set1_epi32(INT32_MIN));
+    }
+
+    // Doubles hold any u32 exactly, and a / b is either a whole number or at
+    // least 1/a > 2^-32 (relative) below the next one, which a correctly
+    // rounded divide with 2^-53 error can't cross, so floor(a / b) is exact
+    FAST_TARGET_AVX2 inline __m128i avx2_divide_u32_epi64(__m128i a, __m128i b) {
+        __m256d q = _mm256_floor_pd(_mm256_div_pd(avx2_cvtepu32_pd(a), avx2_cvtepu32_pd(b)));
+        // b = 0 gives inf or NaN, which the mask below clears anyway
+        q = _mm256_min_pd(q, _mm256_set1_pd(4294967295.0));
+        return avx2_cvtpd_epu32(q);
+    }
+
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_u32(__m256i a, __m256i b) {
+        __m128i q0 = avx2_divide_u32_epi64(_mm256_castsi256_si128(a), _mm256_castsi256_si128(b));
+        __m128i q1 = avx2_divide_u32_epi64(_mm256_extracti128_si256(a, 1), _mm256_extracti128_si256(b, 1));
+        __m256i q = _mm256_inserti128_si256(_mm256_castsi128_si256(q0), q1, 1);
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(b, _mm256_setzero_si256()), q);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_divide_u16(const std::size_t n, uint16_t *q, const uint16_t *a, const uint16_t *b) {
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i), avx2_divide_u16(va, vb));
+        }
+        scalar_divide_u16(n - i, q + i, a + i, b + i);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_divide_u32(const std::size_t n, uint32_t *q, const uint32_t *a, const uint32_t *b) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i), avx2_divide_u32(va, vb));
+        }
+        scalar_divide_u32(n - i, q + i, a + i, b + i);
+    }
+
+    inline void divide_u16(const std::size_t n, uint16_t *q, const uint16_t *a, const uint16_t *b) {
+        if (kernels().level >= isa::avx2) {
+            avx2_divide_u16(n, q, a, b);
+        } else {
+            scalar_divide_u16(n, q, a, b);
+        }
+    }
+
+    inline void divide_u32(const std::size_t n, uint32_t *q, const uint32_t *a, const uint32_t *b) {
+        if (kernels().level >= isa::avx2) {
+            avx2_divide_u32(n, q, a, b);
+        } else {
+            scalar_divide_u32(n, q, a, b);
+        }
+    }
+
+    /* ------------------------------ RGBA8 ------------------------------ */
+
+    // Interleaved 8-bit RGBA, n counts pixels. Both ops compute
+    // min(c * 255 / d, 255) exactly on the colour channels and pass the
+    // first input's alpha through.
+    //
+    // unpremultiply_rgba8: d is the pixel's own alpha, a = 0 gives an all
+    // zero pixel.
+    // divide_blend_rgba8: d is the matching channel of `blend`, the
+    // "divide" blend mode, d = 0 gives 255.
+    inline uint8_t mul255_divide_u8(uint8_t c, uint8_t d) {
+        return static_cast<uint8_t>(std::min(c * 255 / d, 255));
+    }
+
+    inline void scalar_unpremultiply_rgba8(const std::size_t n, uint8_t *out, const uint8_t *in) {
+        for (std::size_t i = 0; i < 4 * n; i += 4) {
+            const uint8_t a = in[i + 3];
+            for (std::size_t c = 0; c < 3; ++c) {
+                out[i + c] = a ? mul255_divide_u8(in[i + c], a) : 0;
+            }
+            out[i + 3] = a;
+        }
+    }
+
+    inline void scalar_divide_blend_rgba8(const std::size_t n, uint8_t *out, const uint8_t *base, const uint8_t *blend) {
+        for (std::size_t i = 0; i < 4 * n; i += 4) {
+            for (std::size_t c = 0; c < 3; ++c) {
+                out[i + c] = blend[i + c] ? mul255_divide_u8(base[i + c], blend[i + c]) : 255;
+            }
+            out[i + 3] = base[i + 3];
+        }
+    }
+
+    // c * 255 goes up to 65025, past what the u8 half-offset trick covers,
+    // so this uses the u16 guess-and-correct. Lanes with d = 0 are garbage.
+    FAST_TARGET_AVX2 inline __m256i avx2_mul255_divide_epi32(__m256i c, __m256i d) {
+        __m256i numerator = _mm256_sub_epi32(_mm256_slli_epi32(c, 8), c);
+        return _mm256_min_epi32(avx2_divide_u16_epi32(numerator, d), _mm256_set1_epi32(255));
+    }
+
+    // Two pixels, one channel per lane, so alpha sits in lanes 3 and 7
+    FAST_TARGET_AVX2 inline __m256i avx2_unpremultiply_epi32(__m256i pixels) {
+        __m256i alpha = _mm256_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+        __m256i q = _mm256_blend_epi32(avx2_mul255_divide_epi32(pixels, alpha), pixels, 0x88);
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(alpha, _mm256_setzero_si256()), q);
+    }
+
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_blend_epi32(__m256i base, __m256i blend) {
+        __m256i q = avx2_mul255_divide_epi32(base, blend);
+        q = _mm256_blendv_epi8(q, _mm256_set1_epi32(255), _mm256_cmpeq_epi32(blend, _mm256_setzero_si256()));
+        return _mm256_blend_epi32(q, base, 0x88);
+    }
+
+    // 8 pixels, as 4 groups of 2 widened to epi32
+    FAST_TARGET_AVX2 inline __m256i avx2_unpremultiply_rgba8(__m256i pixels) {
+        __m128i lo = _mm256_castsi256_si128(pixels);
+        __m128i hi = _mm256_extracti128_si256(pixels, 1);
+        return avx2_pack_u8(avx2_unpremultiply_epi32(_mm256_cvtepu8_epi32(lo)),
+                            avx2_unpremultiply_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8))),
+                            avx2_unpremultiply_epi32(_mm256_cvtepu8_epi32(hi)),
+                            avx2_unpremultiply_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8))));
+    }
+
+    FAST_TARGET_AVX2 inline __m256i avx2_divide_blend_rgba8(__m256i base, __m256i blend) {
+        __m128i base_lo = _mm256_castsi256_si128(base);
+        __m128i base_hi = _mm256_extracti128_si256(base, 1);
+        __m128i blend_lo = _mm256_castsi256_si128(blend);
+        __m128i blend_hi = _mm256_extracti128_si256(blend, 1);
+        return avx2_pack_u8(
+            avx2_divide_blend_epi32(_mm256_cvtepu8_epi32(base_lo), _mm256_cvtepu8_epi32(blend_lo)),
+            avx2_divide_blend_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(base_lo, 8)),
+                                    _mm256_cvtepu8_epi32(_mm_srli_si128(blend_lo, 8))),
+            avx2_divide_blend_epi32(_mm256_cvtepu8_epi32(base_hi), _mm256_cvtepu8_epi32(blend_hi)),
+            avx2_divide_blend_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(base_hi, 8)),
+                                    _mm256_cvtepu8_epi32(_mm_srli_si128(blend_hi, 8))));
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_unpremultiply_rgba8(const std::size_t n, uint8_t *out, const uint8_t *in) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 4 * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * i), avx2_unpremultiply_rgba8(pixels));
+        }
+        scalar_unpremultiply_rgba8(n - i, out + 4 * i, in + 4 * i);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_divide_blend_rgba8(const std::size_t n, uint8_t *out, const uint8_t *base, const uint8_t *blend) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m256i vbase = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + 4 * i));
+            __m256i vblend = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(blend + 4 * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * i), avx2_divide_blend_rgba8(vbase, vblend));
+        }
+        scalar_divide_blend_rgba8(n - i, out + 4 * i, base + 4 * i, blend + 4 * i);
+    }
+
+    inline void unpremultiply_rgba8(const std::size_t n, uint8_t *out, const uint8_t *in) {
+        if (kernels().level >= isa::avx2) {
+            avx2_unpremultiply_rgba8(n, out, in);
+        } else {
+            scalar_unpremultiply_rgba8(n, out, in);
+        }
+    }
+
+    inline void divide_blend_rgba8(const std::size_t n, uint8_t *out, const uint8_t *base, const uint8_t *blend) {
+        if (kernels().level >= isa::avx2) {
+            avx2_divide_blend_rgba8(n, out, base, blend);
+        } else {
+            scalar_divide_blend_rgba8(n, out, base, blend);
+        }
+    }
+
+    // Divides by one runtime divisor, for whole buffers. The reciprocal is
+    // worked out once as a 16-bit fixed-point multiplier rounded up,
+    // M = 2^16 / d + 1, so a / d = (a * M) >> 16. The error M * d - 2^16 is
+    // at most d, and a * d < 2^16 keeps it from ever reaching the next
+    // integer, so this is exact for every u8 a and d >= 2. d = 1 would need
+    // M = 2^16 and is a copy instead. Division by zero gives 0 like
+    // divide_u8.
+    class divider_u8 {
+    public:
+        explicit divider_u8(uint8_t divisor)
+            : divisor_(divisor), multiplier_(divisor > 1 ? static_cast<uint16_t>(65536 / divisor + 1) : 0) {}
+
+        uint8_t divisor() const { return divisor_; }
+        uint16_t multiplier() const { return multiplier_; }
+
+        uint8_t divide(uint8_t a) const {
+            return divisor_ == 1 ? a : static_cast<uint8_t>((a * multiplier_) >> 16);
+        }
+
+        // q may alias a
+        inline void divide(const std::size_t n, uint8_t *q, const uint8_t *a) const;
+
+    private:
+        uint8_t divisor_;
+        uint16_t multiplier_;
+    };
+
+    inline void scalar_divide_u8(const std::size_t n, uint8_t *q, const uint8_t *a, const divider_u8& d) {
+        for (std::size_t i = 0; i < n; ++i) {
+            q[i] = d.divide(a[i]);
+        }
+    }
+
+    // (a * multiplier) >> 16 for 32 u8 lanes. Bytes are widened to u16 and
+    // vpmulhuw does the multiply and shift in one, unpack and pack both stay
+    // within 128-bit lanes so the order comes back out unchanged
+    FAST_TARGET_AVX2 inline __m256i avx2_mulhi_u8(__m256i a, __m256i multiplier) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i lo = _mm256_mulhi_epu16(_mm256_unpacklo_epi8(a, zero), multiplier);
+        __m256i hi = _mm256_mulhi_epu16(_mm256_unpackhi_epi8(a, zero), multiplier);
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_divide_u8(const std::size_t n, uint8_t *q, const uint8_t *a, const divider_u8& d) {
+        if (d.divisor() == 1) {
+            if (q != a) {
+                std::copy(a, a + n, q);
+            }
+            return;
+        }
+
+        const __m256i multiplier = _mm256_set1_epi16(static_cast<int16_t>(d.multiplier()));
+        std::size_t i = 0;
+        for (; i + 63 < n; i += 64) {
+            __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i), avx2_mulhi_u8(a0, multiplier));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i + 32), avx2_mulhi_u8(a1, multiplier));
+        }
+        for (; i + 31 < n; i += 32) {
+            __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(q + i), avx2_mulhi_u8(a0, multiplier));
+        }
+        scalar_divide_u8(n - i, q + i, a + i, d);
+    }
+
+    inline void divider_u8::divide(const std::size_t n, uint8_t *q, const uint8_t *a) const {
+        if (kernels().level >= isa::avx2) {
+            avx2_divide_u8(n, q, a, *this);
+        } else {
+            scalar_divide_u8(n, q, a, *this);
+        }
+    }
+}
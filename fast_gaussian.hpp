@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+
+namespace fast {
+
+    // exp(-t^2 / 2) as magic * t^2 + bits(1.0f) written straight into the
+    // float bits, fast_gaussian in gaussian.cc. ~4.3e-2 max abs error.
+    constexpr float gaussian_magic = -6051101.5f; // (1 << 23) * 0.5 * log2(e) * -1
+    constexpr float gaussian_one = 0x3f800000;
+
+    inline float gaussian(float t) {
+        // Past |t| ~ 13.3 the bits would go negative, clamp them to +0.0f
+        float bits = std::max(gaussian_magic * t * t + gaussian_one, 0.0f);
+        return std::bit_cast<float>(static_cast<uint32_t>(bits));
+    }
+
+    // One Newton step on h(y) = ln(y) + t^2 / 2, refine_gaussian in
+    // gaussian.cc. With the hack::flog from there the step only gets to
+    // ~3.5e-2, the minimax log2 brings it to ~1.3e-3 max abs error.
+    inline float refine_gaussian(float t, float y) {
+        const float ln2 = 0.693147180559945309f;
+        return y * (1.0f - ln2 * log2_minimax(y) - 0.5f * t * t);
+    }
+
+    inline float gaussian_refined(float t) {
+        return refine_gaussian(t, gaussian(t));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_gaussian_f32(__m256 t) {
+        __m256 bits = _mm256_fmadd_ps(_mm256_set1_ps(gaussian_magic), _mm256_mul_ps(t, t), _mm256_set1_ps(gaussian_one));
+        bits = _mm256_max_ps(bits, _mm256_setzero_ps());
+        return _mm256_castsi256_ps(_mm256_cvttps_epi32(bits));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_gaussian_refined_f32(__m256 t) {
+        const __m256 ln2 = _mm256_set1_ps(0.693147180559945309f);
+        __m256 y = avx2_gaussian_f32(t);
+        __m256 correction = _mm256_fnmadd_ps(ln2, avx2_log2_minimax_f32(y), _mm256_set1_ps(1.0f));
+        correction = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(t, t), correction);
+        return _mm256_mul_ps(y, correction);
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_gaussian_f32(__m512 t) {
+        __m512 bits = _mm512_fmadd_ps(_mm512_set1_ps(gaussian_magic), _mm512_mul_ps(t, t), _mm512_set1_ps(gaussian_one));
+        bits = _mm512_max_ps(bits, _mm512_setzero_ps());
+        return _mm512_castsi512_ps(_mm512_cvttps_epi32(bits));
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_gaussian_refined_f32(__m512 t) {
+        const __m512 ln2 = _mm512_set1_ps(0.693147180559945309f);
+        __m512 y = avx512_gaussian_f32(t);
+        __m512 correction = _mm512_fnmadd_ps(ln2, avx512_log2_minimax_f32(y), _mm512_set1_ps(1.0f));
+        correction = _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), _mm512_mul_ps(t, t), correction);
+        return _mm512_mul_ps(y, correction);
+    }
+
+    // exp(-t^2 / 2) with integer multiply-adds on the float bits only, the
+    // fast_gaussian_v3/v4 idea in gaussian.cc, so it can run on the integer
+    // ports while the FP ports are busy. Instead of the evil_square bit
+    // trick t^2 is squared exactly in fixed point, then written into the
+    // exponent bits Schraudolph style and the linear mantissa is bent
+    // towards 2^f with an integer quadratic. Max abs error 1.9e-3 over all
+    // floats, max rel error 3.4e-3 for |t| <= 3.
+    constexpr uint32_t gaussian_int_clamp = 0x41600000; // 14.0f, exp(-98) is 0 anyway
+    constexpr uint32_t gaussian_int_scale = 39358;      // sqrt(1 / ln2) in Q15
+    constexpr int32_t gaussian_int_bias = 0x3F800000 - 13700;
+    constexpr uint32_t gaussian_int_curve = 43;         // 2^f ~ 1 + f - (43 / 128) f (1 - f)
+
+    inline float gaussian_int(float t) {
+        uint32_t i = std::min(std::bit_cast<uint32_t>(t) & 0x7FFFFFFFu, gaussian_int_clamp);
+
+        // 16 bits of mantissa times the scale gives |t| sqrt(1 / ln2) * 2^(157 - exponent),
+        // shift it down to Q11 so q^2 = t^2 / (2 ln2) * 2^23
+        uint32_t exponent = i >> 23;
+        uint32_t product = (((i & 0x007FFFFF) | 0x00800000) >> 8) * gaussian_int_scale;
+        uint32_t shift = 146 - exponent;
+        uint32_t q = shift < 32 ? product >> shift : 0;
+
+        int32_t bits = std::max(gaussian_int_bias - static_cast<int32_t>(q * q), 0);
+
+        uint32_t m = (bits & 0x007FFFFF) >> 8;
+        bits -= static_cast<int32_t>(((m * (0x8000 - m)) >> 14) * gaussian_int_curve);
+        return std::bit_cast<float>(bits);
+    }
+
+    // vpsrlvd shifts out everything for counts of 32 and up, which covers
+    // the tiny |t| case without a compare
+    FAST_TARGET_AVX2 inline __m256 avx2_gaussian_int_f32(__m256 t) {
+        __m256i i = _mm256_and_si256(_mm256_castps_si256(t), _mm256_set1_epi32(0x7FFFFFFF));
+        i = _mm256_min_epi32(i, _mm256_set1_epi32(gaussian_int_clamp));
+
+        __m256i exponent = _mm256_srli_epi32(i, 23);
+        __m256i mantissa = _mm256_srli_epi32(
+            _mm256_or_si256(_mm256_and_si256(i, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x00800000)), 8);
+        __m256i product = _mm256_mullo_epi32(mantissa, _mm256_set1_epi32(gaussian_int_scale));
+        __m256i q = _mm256_srlv_epi32(product, _mm256_sub_epi32(_mm256_set1_epi32(146), exponent));
+
+        __m256i bits = _mm256_max_epi32(_mm256_sub_epi32(_mm256_set1_epi32(gaussian_int_bias), _mm256_mullo_epi32(q, q)),
+                                        _mm256_setzero_si256());
+
+        __m256i m = _mm256_srli_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), 8);
+        __m256i curve = _mm256_srli_epi32(_mm256_mullo_epi32(m, _mm256_sub_epi32(_mm256_set1_epi32(0x8000), m)), 14);
+        curve = _mm256_mullo_epi32(curve, _mm256_set1_epi32(gaussian_int_curve));
+        return _mm256_castsi256_ps(_mm256_sub_epi32(bits, curve));
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_gaussian_int_f32(__m512 t) {
+        __m512i i = _mm512_and_si512(_mm512_castps_si512(t), _mm512_set1_epi32(0x7FFFFFFF));
+        i = _mm512_min_epi32(i, _mm512_set1_epi32(gaussian_int_clamp));
+
+        __m512i exponent = _mm512_srli_epi32(i, 23);
+        __m512i mantissa = _mm512_srli_epi32(
+            _mm512_or_si512(_mm512_and_si512(i, _mm512_set1_epi32(0x007FFFFF)), _mm512_set1_epi32(0x00800000)), 8);
+        __m512i product = _mm512_mullo_epi32(mantissa, _mm512_set1_epi32(gaussian_int_scale));
+        __m512i q = _mm512_srlv_epi32(product, _mm512_sub_epi32(_mm512_set1_epi32(146), exponent));
+
+        __m512i bits = _mm512_max_epi32(_mm512_sub_epi32(_mm512_set1_epi32(gaussian_int_bias), _mm512_mullo_epi32(q, q)),
+                                        _mm512_setzero_si512());
+
+        __m512i m = _mm512_srli_epi32(_mm512_and_si512(bits, _mm512_set1_epi32(0x007FFFFF)), 8);
+        __m512i curve = _mm512_srli_epi32(_mm512_mullo_epi32(m, _mm512_sub_epi32(_mm512_set1_epi32(0x8000), m)), 14);
+        curve = _mm512_mullo_epi32(curve, _mm512_set1_epi32(gaussian_int_curve));
+        return _mm512_castsi512_ps(_mm512_sub_epi32(bits, curve));
+    }
+
+    // Array forms compute y[i] = gaussian((x[i] - mu) / sigma), Refined
+    // selects the Newton corrected kernel
+    template<bool Refined = false>
+    inline void scalar_gaussian_f32(const std::size_t n, float *y, const float *x, float mu, float sigma) {
+        const float inv_sigma = 1.0f / sigma;
+        for (std::size_t i = 0; i < n; ++i) {
+            float t = (x[i] - mu) * inv_sigma;
+            y[i] = Refined ? fast::gaussian_refined(t) : fast::gaussian(t);
+        }
+    }
+
+    template<bool Refined = false>
+    FAST_TARGET_AVX2 inline void avx2_gaussian_f32(const std::size_t n, float *y, const float *x, float mu, float sigma) {
+        const __m256 vmu = _mm256_set1_ps(mu);
+        const __m256 inv_sigma = _mm256_set1_ps(1.0f / sigma);
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vmu), inv_sigma);
+            _mm256_storeu_ps(y + i, Refined ? avx2_gaussian_refined_f32(t) : avx2_gaussian_f32(t));
+        }
+        scalar_gaussian_f32<Refined>(n - i, y + i, x + i, mu, sigma);
+    }
+
+    template<bool Refined = false>
+    FAST_TARGET_AVX512 inline void avx512_gaussian_f32(const std::size_t n, float *y, const float *x, float mu, float sigma) {
+        const __m512 vmu = _mm512_set1_ps(mu);
+        const __m512 inv_sigma = _mm512_set1_ps(1.0f / sigma);
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            __m512 t = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(x + i), vmu), inv_sigma);
+            _mm512_storeu_ps(y + i, Refined ? avx512_gaussian_refined_f32(t) : avx512_gaussian_f32(t));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            __m512 t = _mm512_mul_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x + i), vmu), inv_sigma);
+            _mm512_mask_storeu_ps(y + i, mask, Refined ? avx512_gaussian_refined_f32(t) : avx512_gaussian_f32(t));
+        }
+    }
+
+    // Unnormalized Gaussian weights out[i] = exp(-((in[i] - mu) / sigma)^2 / 2),
+    // out must be at least as long as in
+    template<bool Refined = false>
+    inline void gaussian(std::span<const float> in, std::span<float> out, float mu, float sigma) {
+        switch (kernels().level) {
+        case isa::avx512:
+            avx512_gaussian_f32<Refined>(in.size(), out.data(), in.data(), mu, sigma);
+            break;
+        case isa::avx2:
+            avx2_gaussian_f32<Refined>(in.size(), out.data(), in.data(), mu, sigma);
+            break;
+        default:
+            scalar_gaussian_f32<Refined>(in.size(), out.data(), in.data(), mu, sigma);
+            break;
+        }
+    }
+
+    inline void gaussian_refined(std::span<const float> in, std::span<float> out, float mu, float sigma) {
+        gaussian<true>(in, out, mu, sigma);
+    }
+
+    // Integer forms take t directly, subtracting mu and dividing by sigma
+    // would put the FP ports back in the loop
+    inline void scalar_gaussian_int_f32(const std::size_t n, float *y, const float *t) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::gaussian_int(t[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_gaussian_int_f32(const std::size_t n, float *y, const float *t) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_gaussian_int_f32(_mm256_loadu_ps(t + i)));
+        }
+        scalar_gaussian_int_f32(n - i, y + i, t + i);
+    }
+
+    FAST_TARGET_AVX512 inline void avx512_gaussian_int_f32(const std::size_t n, float *y, const float *t) {
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, avx512_gaussian_int_f32(_mm512_loadu_ps(t + i)));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, avx512_gaussian_int_f32(_mm512_maskz_loadu_ps(mask, t + i)));
+        }
+    }
+
+    // out[i] = exp(-in[i]^2 / 2), out must be at least as long as in
+    inline void gaussian_int(std::span<const float> in, std::span<float> out) {
+        switch (kernels().level) {
+        case isa::avx512:
+            avx512_gaussian_int_f32(in.size(), out.data(), in.data());
+            break;
+        case isa::avx2:
+            avx2_gaussian_int_f32(in.size(), out.data(), in.data());
+            break;
+        default:
+            scalar_gaussian_int_f32(in.size(), out.data(), in.data());
+            break;
+        }
+    }
+}
@@ -0,0 +1,1343 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "thread_pool.hpp"
+
+// Per-function target attributes work on both GCC and clang, unlike
+// `#pragma clang attribute`, so the SIMD kernels can live in one binary
+// next to the scalar fallbacks and get picked at runtime.
+#define FAST_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define FAST_TARGET_AVX2 __attribute__((target("avx,avx2,fma")))
+#define FAST_TARGET_AVX512 __attribute__((target("avx,avx2,fma,avx512f,avx512dq")))
+
+namespace fast {
+
+    // Schraudolph exp: magic * x + bias reinterpreted as float bits. The
+    // bias is 1.0f (0x3f800000) nudged down so the error is spread evenly
+    // above and below e^x, ~3% max relative error instead of ~6%.
+    //constexpr float exp_magic = 214760456192.0f; // more accurate for large values, loses significant precision for small values
+    constexpr float exp_magic = 12102203.2f; // approx. (2^23) * log2(e)
+    constexpr float exp_bias = 0x3F7A8480; // 1.0f, converted to a float
+    constexpr float exp_bits_max = 0x7F800000; // +inf, converted to a float
+
+    /* --------------------------- scalar --------------------------- */
+
+    // Below about x = -88 the fma goes negative and would truncate to the
+    // bits of a negative float, so it is clamped at 0 (which is 0.0f).
+    // Above about x = 88 it is clamped at the bits of +inf, which also
+    // keeps the cast to int32_t in range.
+    inline float exp(float x) {
+        float bits = std::min(std::max(std::fma(exp_magic, x, exp_bias), 0.0f), exp_bits_max);
+        return std::bit_cast<float>((int32_t)bits);
+    }
+
+    inline float weird_log(float x) {
+        const float curvature = 36707.375f; // optimized value
+        return std::bit_cast<float>((uint32_t)(-0x3f800000 - curvature*x)) + 7;
+    }
+
+    inline float log(float x) {
+        const float magic_scale = 8.26295831757307e-08f; // float epsilon * ln(2)
+        const int32_t offset = std::bit_cast<int32_t>(1.0f); // 0x3f800000
+        int32_t i = std::bit_cast<int32_t>(x);
+        return magic_scale * (float)(i - offset);
+    }
+
+    inline float approx_log2_interpolated_2bit(float x) {
+        uint32_t i = std::bit_cast<uint32_t>(x);
+
+        int32_t exponent = static_cast<int32_t>((i >> 23) & 0xFF) - 127;
+
+        uint32_t mantissa_bits = (i & 0x007FFFFF) | 0x3F800000;
+        float m = std::bit_cast<float>(mantissa_bits);
+
+        // 3. 2-bit Table (2^2 = 4 entries + 1 for boundary)
+        // table[i] = log2(1 + i/4)
+        static constexpr float table[5] = {
+            0.00000000f, // log2(1.00)
+            0.32192809f, // log2(1.25)
+            0.58496250f, // log2(1.50)
+            0.80735492f, // log2(1.75)
+            1.00000000f  // log2(2.00) - for easy interpolation
+        };
+
+        float f = m - 1.0f;
+        float scaled_f = f * 4.0f;
+        int index = static_cast<int>(scaled_f);
+        float fraction = scaled_f - static_cast<float>(index);
+
+        float log2_mantissa = table[index] + fraction * (table[index + 1] - table[index]);
+
+        return static_cast<float>(exponent) + log2_mantissa;
+    }
+
+    // 2^x from floor(x) written straight into the exponent bits and 2^frac
+    // from a 2-bit table lerp, see approx_exp2_interpolated_2bit in
+    // tanh_lookup_table.py. Much more accurate than the Schraudolph exp
+    // (~0.4% max rel error instead of ~3%) for a few more instructions.
+    inline float exp2_interp2(float x) {
+        // table[i] = 2^(i/4)
+        static constexpr float table[5] = {
+            1.00000000f,
+            1.18920712f,
+            1.41421356f,
+            1.68179283f,
+            2.00000000f
+        };
+
+        // Below this the result would be denormal, flush to zero
+        if (!(x >= -126.0f)) {
+            return 0.0f;
+        }
+        x = std::min(x, 127.99999f);
+
+        // Work in quarters: the low 2 bits of floor(4x) are the table index
+        // and the rest is floor(x)
+        float scaled_x = x * 4.0f;
+        float floor_x = std::floor(scaled_x);
+        int32_t quarters = static_cast<int32_t>(floor_x);
+        int32_t exponent = quarters >> 2;
+        int index = quarters & 3;
+        float fraction = scaled_x - floor_x;
+
+        float exp2_mantissa = table[index] + fraction * (table[index + 1] - table[index]);
+
+        return std::bit_cast<float>(std::bit_cast<int32_t>(exp2_mantissa) + (exponent << 23));
+    }
+
+    inline float exp_interp2(float x) {
+        const float log2_e = 1.44269504088896341f;
+        return exp2_interp2(x * log2_e);
+    }
+
+    // reciprocal_1_f from u8_divide.cc (~1e-3 rel error) plus one Newton
+    // step, ~1.4e-6 rel error for normal, positive or negative x
+    inline float rcp(float x) {
+        float y = std::bit_cast<float>(0x7eb504f3u - std::bit_cast<uint32_t>(x));
+        y = 1.94285123f * y * (1.43566f - x * y);
+        return y * (2.0f - x * y);
+    }
+
+    // Minimax (absolute error) fit of log2(1 + f) on [0, 1), lowest order
+    // first. Generated by remez.hpp, test_remez checks it still matches.
+    constexpr std::array<float, 6> log2_minimax_5 = {
+        1.25386050e-05f, 1.44168460e+00f, -7.07992673e-01f,
+        4.13630188e-01f, -1.92195728e-01f, 4.48736511e-02f};
+
+    // log2 from the exponent bits plus a degree 5 polynomial on the mantissa,
+    // ~1.3e-5 absolute error. Only valid for positive, normal x.
+    inline float log2_minimax(float x) {
+        int32_t i = std::bit_cast<int32_t>(x);
+        float exponent = static_cast<float>((i >> 23) - 127);
+        float f = std::bit_cast<float>((i & 0x007FFFFF) | 0x3F800000) - 1.0f;
+
+        float p = log2_minimax_5[5];
+        for (std::size_t k = 5; k-- > 0;) {
+            p = p * f + log2_minimax_5[k];
+        }
+        return exponent + p;
+    }
+
+    inline float softmax(std::vector<float>& input) {
+        auto max_val = *std::max_element(input.begin(), input.end());
+        float sum = 0.0f;
+        std::transform(input.begin(), input.end(), input.begin(),
+        [max_val, &sum](float val) {
+            float exp_val = fast::exp(val - max_val);
+            sum += exp_val;
+            return exp_val;
+        });
+
+        float inv_sum = 1.0 / sum;
+        std::transform(input.begin(), input.end(), input.begin(),
+            [inv_sum](float val) { return val * inv_sum; });
+
+        return sum;
+    }
+
+    inline void scalar_exp_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::exp(x[i]);
+        }
+    }
+
+    inline void scalar_log_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::log(x[i]);
+        }
+    }
+
+    // Writes exp(x - max) to y and returns the sum
+    inline float scalar_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        float sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            float val = fast::exp(x[i] - max);
+            sum += val;
+            y[i] = val;
+        }
+        return sum;
+    }
+
+    inline void scalar_weird_log_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::weird_log(x[i]);
+        }
+    }
+
+    inline void scalar_log2_interp2_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::approx_log2_interpolated_2bit(x[i]);
+        }
+    }
+
+    inline void scalar_exp_interp2_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::exp_interp2(x[i]);
+        }
+    }
+
+    inline float scalar_max_f32(const std::size_t n, const float *x) {
+        float max = -INFINITY;
+        for (std::size_t i = 0; i < n; ++i) {
+            max = std::max(max, x[i]);
+        }
+        return max;
+    }
+
+    inline void scalar_scale_f32(const std::size_t n, float *y, float scale) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] *= scale;
+        }
+    }
+
+    inline float scalar_sum_exp_f32(const std::size_t n, const float *x, float max) {
+        float sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += fast::exp(x[i] - max);
+        }
+        return sum;
+    }
+
+    inline void scalar_offset_f32(const std::size_t n, float *y, const float *x, float offset) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = x[i] + offset;
+        }
+    }
+
+    /* --------------------------- SSE4.1 --------------------------- */
+
+    FAST_TARGET_SSE41 inline __m128 sse41_exp_f32(__m128 x) {
+        const __m128 magic = _mm_set1_ps(exp_magic);
+        const __m128 offset = _mm_set1_ps(exp_bias);
+
+        // No FMA at this level, the extra rounding step is well below the
+        // error of the approximation itself
+        __m128 bits = _mm_max_ps(_mm_add_ps(_mm_mul_ps(magic, x), offset), _mm_setzero_ps());
+        bits = _mm_min_ps(bits, _mm_set1_ps(exp_bits_max));
+        return _mm_castsi128_ps(_mm_cvttps_epi32(bits));
+    }
+
+    FAST_TARGET_SSE41 inline __m128 sse41_log_f32(__m128 x) {
+        const __m128 magic_scale = _mm_set1_ps(8.26295831757307e-08f);
+        const __m128i offset = _mm_set1_epi32(0x3f800000);
+
+        __m128i i = _mm_sub_epi32(_mm_castps_si128(x), offset);
+        return _mm_mul_ps(magic_scale, _mm_cvtepi32_ps(i));
+    }
+
+    FAST_TARGET_SSE41 inline void sse41_exp_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 3 < n; i += 4) {
+            _mm_storeu_ps(y + i, sse41_exp_f32(_mm_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::exp(x[i]);
+        }
+    }
+
+    FAST_TARGET_SSE41 inline void sse41_log_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 3 < n; i += 4) {
+            _mm_storeu_ps(y + i, sse41_log_f32(_mm_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::log(x[i]);
+        }
+    }
+
+    FAST_TARGET_SSE41 inline float sse41_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        std::size_t i = 0;
+        __m128 acc = _mm_setzero_ps();
+        const __m128 vmax = _mm_set1_ps(max);
+        for (; i + 3 < n; i += 4) {
+            __m128 val = sse41_exp_f32(_mm_sub_ps(_mm_loadu_ps(x + i), vmax));
+            _mm_storeu_ps(y + i, val);
+            acc = _mm_add_ps(acc, val);
+        }
+
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_movehdup_ps(acc));
+        float sum = _mm_cvtss_f32(acc);
+
+        for (; i < n; ++i) {
+            float val = fast::exp(x[i] - max);
+            sum += val;
+            y[i] = val;
+        }
+
+        return sum;
+    }
+
+    FAST_TARGET_SSE41 inline float sse41_max_f32(const std::size_t n, const float *x) {
+        std::size_t i = 0;
+        __m128 acc = _mm_set1_ps(-INFINITY);
+        for (; i + 3 < n; i += 4) {
+            acc = _mm_max_ps(acc, _mm_loadu_ps(x + i));
+        }
+
+        acc = _mm_max_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_max_ss(acc, _mm_movehdup_ps(acc));
+        float max = _mm_cvtss_f32(acc);
+
+        for (; i < n; ++i) {
+            max = std::max(max, x[i]);
+        }
+        return max;
+    }
+
+    FAST_TARGET_SSE41 inline void sse41_scale_f32(const std::size_t n, float *y, float scale) {
+        std::size_t i = 0;
+        const __m128 vscale = _mm_set1_ps(scale);
+        for (; i + 3 < n; i += 4) {
+            _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), vscale));
+        }
+        for (; i < n; ++i) {
+            y[i] *= scale;
+        }
+    }
+
+    FAST_TARGET_SSE41 inline float sse41_sum_exp_f32(const std::size_t n, const float *x, float max) {
+        std::size_t i = 0;
+        __m128 acc = _mm_setzero_ps();
+        const __m128 vmax = _mm_set1_ps(max);
+        for (; i + 3 < n; i += 4) {
+            acc = _mm_add_ps(acc, sse41_exp_f32(_mm_sub_ps(_mm_loadu_ps(x + i), vmax)));
+        }
+
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_movehdup_ps(acc));
+        float sum = _mm_cvtss_f32(acc);
+
+        for (; i < n; ++i) {
+            sum += fast::exp(x[i] - max);
+        }
+        return sum;
+    }
+
+    FAST_TARGET_SSE41 inline void sse41_offset_f32(const std::size_t n, float *y, const float *x, float offset) {
+        std::size_t i = 0;
+        const __m128 voffset = _mm_set1_ps(offset);
+        for (; i + 3 < n; i += 4) {
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(x + i), voffset));
+        }
+        for (; i < n; ++i) {
+            y[i] = x[i] + offset;
+        }
+    }
+
+    /* ---------------------------- AVX2 ---------------------------- */
+
+    FAST_TARGET_AVX2 inline __m256 avx2_exp_f32(__m256 x) {
+        const __m256 magic = _mm256_set1_ps(exp_magic);
+        const __m256 offset = _mm256_set1_ps(exp_bias);
+
+        __m256 bits = _mm256_max_ps(_mm256_fmadd_ps(magic, x, offset), _mm256_setzero_ps());
+        bits = _mm256_min_ps(bits, _mm256_set1_ps(exp_bits_max));
+        return _mm256_castsi256_ps(_mm256_cvttps_epi32(bits));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_log_f32(__m256 x) {
+        const __m256 magic_scale = _mm256_set1_ps(8.26295831757307e-08f);
+        const __m256i offset = _mm256_set1_epi32(0x3f800000);
+
+        __m256i i = _mm256_sub_epi32(_mm256_castps_si256(x), offset);
+        return _mm256_mul_ps(magic_scale, _mm256_cvtepi32_ps(i));
+    }
+
+    // Matches fast::weird_log as long as curvature*x stays below 2^31 - 0x3f800000
+    FAST_TARGET_AVX2 inline __m256 avx2_weird_log_f32(__m256 x) {
+        const __m256 curvature = _mm256_set1_ps(36707.375f);
+        const __m256 offset = _mm256_set1_ps(-0x3f800000);
+
+        __m256i i = _mm256_cvttps_epi32(_mm256_fnmadd_ps(curvature, x, offset));
+        return _mm256_add_ps(_mm256_castsi256_ps(i), _mm256_set1_ps(7.0f));
+    }
+
+    // Vector form of fast::approx_log2_interpolated_2bit. The top two
+    // mantissa bits are the table index and the remaining 21 the lerp
+    // fraction, and the whole table fits in a ymm so the lookup is a
+    // vpermps instead of a gather.
+    FAST_TARGET_AVX2 inline __m256 avx2_log2_interp2_f32(__m256 x) {
+        const __m256 table = _mm256_setr_ps(
+            0.00000000f, // log2(1.00)
+            0.32192809f, // log2(1.25)
+            0.58496250f, // log2(1.50)
+            0.80735492f, // log2(1.75)
+            0.0f, 0.0f, 0.0f, 0.0f);
+        const __m256 slopes = _mm256_setr_ps(
+            0.32192809f - 0.00000000f,
+            0.58496250f - 0.32192809f,
+            0.80735492f - 0.58496250f,
+            1.00000000f - 0.80735492f,
+            0.0f, 0.0f, 0.0f, 0.0f);
+
+        __m256i i = _mm256_castps_si256(x);
+        __m256i exponent = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(i, 23), _mm256_set1_epi32(0xFF)),
+                                            _mm256_set1_epi32(127));
+        __m256i index = _mm256_and_si256(_mm256_srli_epi32(i, 21), _mm256_set1_epi32(3));
+        __m256 fraction = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(i, _mm256_set1_epi32(0x1FFFFF))),
+                                        _mm256_set1_ps(1.0f / (1 << 21)));
+
+        __m256 log2_mantissa = _mm256_fmadd_ps(fraction, _mm256_permutevar8x32_ps(slopes, index),
+                                               _mm256_permutevar8x32_ps(table, index));
+        return _mm256_add_ps(_mm256_cvtepi32_ps(exponent), log2_mantissa);
+    }
+
+    // Vector form of fast::exp2_interp2, the 4 table entries and slopes are
+    // looked up with vpermps
+    FAST_TARGET_AVX2 inline __m256 avx2_exp2_interp2_f32(__m256 x) {
+        const __m256 table = _mm256_setr_ps(
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f,
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f);
+        const __m256 slopes = _mm256_setr_ps(
+            1.18920712f - 1.00000000f,
+            1.41421356f - 1.18920712f,
+            1.68179283f - 1.41421356f,
+            2.00000000f - 1.68179283f,
+            1.18920712f - 1.00000000f,
+            1.41421356f - 1.18920712f,
+            1.68179283f - 1.41421356f,
+            2.00000000f - 1.68179283f);
+
+        // Also false for NaN, which then comes out as 0 like in the scalar version
+        __m256 in_range = _mm256_cmp_ps(x, _mm256_set1_ps(-126.0f), _CMP_GE_OQ);
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.99999f));
+
+        __m256 scaled_x = _mm256_mul_ps(x, _mm256_set1_ps(4.0f));
+        __m256 floor_x = _mm256_floor_ps(scaled_x);
+        __m256i quarters = _mm256_cvttps_epi32(floor_x);
+        __m256 fraction = _mm256_sub_ps(scaled_x, floor_x);
+
+        // vpermps only looks at the low 3 bits of the index, and bit 2 never
+        // reaches the padding because the table is repeated in both halves
+        __m256 exp2_mantissa = _mm256_fmadd_ps(fraction, _mm256_permutevar8x32_ps(slopes, quarters),
+                                               _mm256_permutevar8x32_ps(table, quarters));
+        __m256i exponent = _mm256_slli_epi32(_mm256_srai_epi32(quarters, 2), 23);
+        __m256 result = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(exp2_mantissa), exponent));
+        return _mm256_and_ps(result, in_range);
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_exp_interp2_f32(__m256 x) {
+        const __m256 log2_e = _mm256_set1_ps(1.44269504088896341f);
+        return avx2_exp2_interp2_f32(_mm256_mul_ps(x, log2_e));
+    }
+
+    // vrcpps is only good to ~12 bits, one Newton step brings it to ~22
+    FAST_TARGET_AVX2 inline __m256 avx2_rcp_f32(__m256 x) {
+        __m256 y = _mm256_rcp_ps(x);
+        return _mm256_mul_ps(y, _mm256_fnmadd_ps(x, y, _mm256_set1_ps(2.0f)));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_log2_minimax_f32(__m256 x) {
+        __m256i i = _mm256_castps_si256(x);
+        __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(i, 23), _mm256_set1_epi32(127)));
+        __m256 f = _mm256_sub_ps(
+            _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(i, _mm256_set1_epi32(0x007FFFFF)),
+                                                _mm256_set1_epi32(0x3F800000))),
+            _mm256_set1_ps(1.0f));
+
+        __m256 p = _mm256_set1_ps(log2_minimax_5[5]);
+        for (std::size_t k = 5; k-- > 0;) {
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(log2_minimax_5[k]));
+        }
+        return _mm256_add_ps(exponent, p);
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_exp_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_exp_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::exp(x[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_log_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_log_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::log(x[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_weird_log_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_weird_log_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::weird_log(x[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_log2_interp2_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_log2_interp2_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::approx_log2_interpolated_2bit(x[i]);
+        }
+    }
+
+    // _mm256_reduce_add_ps() doesn't exist, so instead extract the results
+    // 128 bits at a time
+    FAST_TARGET_AVX2 inline float avx2_reduce_add_ps(__m256 x) {
+        __m128 val = _mm_add_ps(_mm256_extractf128_ps(x, 1), _mm256_castps256_ps128(x));
+        val = _mm_add_ps(val, _mm_movehl_ps(val, val));
+        val = _mm_add_ss(val, _mm_movehdup_ps(val));
+        return _mm_cvtss_f32(val);
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_reduce_max_ps(__m256 x) {
+        __m128 val = _mm_max_ps(_mm256_extractf128_ps(x, 1), _mm256_castps256_ps128(x));
+        val = _mm_max_ps(val, _mm_movehl_ps(val, val));
+        val = _mm_max_ss(val, _mm_movehdup_ps(val));
+        return _mm_cvtss_f32(val);
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        std::size_t i = 0;
+        __m256 acc = _mm256_setzero_ps();
+        const __m256 vmax = _mm256_set1_ps(max);
+        // We have a full 256 bit lane available, only reduce once at the end
+        for(; i + 7 < n; i += 8) {
+            __m256 val = avx2_exp_f32(_mm256_sub_ps(_mm256_loadu_ps(x+i), vmax));
+            _mm256_storeu_ps(y + i, val);
+            acc = _mm256_add_ps(acc, val);
+        }
+
+        float sum = avx2_reduce_add_ps(acc);
+        for (; i < n; ++i) {
+            float val = fast::exp(x[i] - max);
+            sum += val;
+            y[i] = val;
+        }
+
+        return sum;
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_exp_interp2_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_exp_interp2_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::exp_interp2(x[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_max_f32(const std::size_t n, const float *x) {
+        std::size_t i = 0;
+        __m256 acc = _mm256_set1_ps(-INFINITY);
+        for (; i + 7 < n; i += 8) {
+            acc = _mm256_max_ps(acc, _mm256_loadu_ps(x + i));
+        }
+
+        float max = avx2_reduce_max_ps(acc);
+        for (; i < n; ++i) {
+            max = std::max(max, x[i]);
+        }
+        return max;
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_scale_f32(const std::size_t n, float *y, float scale) {
+        std::size_t i = 0;
+        const __m256 vscale = _mm256_set1_ps(scale);
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), vscale));
+        }
+        for (; i < n; ++i) {
+            y[i] *= scale;
+        }
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_sum_exp_f32(const std::size_t n, const float *x, float max) {
+        std::size_t i = 0;
+        __m256 acc = _mm256_setzero_ps();
+        const __m256 vmax = _mm256_set1_ps(max);
+        for (; i + 7 < n; i += 8) {
+            acc = _mm256_add_ps(acc, avx2_exp_f32(_mm256_sub_ps(_mm256_loadu_ps(x + i), vmax)));
+        }
+
+        float sum = avx2_reduce_add_ps(acc);
+        for (; i < n; ++i) {
+            sum += fast::exp(x[i] - max);
+        }
+        return sum;
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_offset_f32(const std::size_t n, float *y, const float *x, float offset) {
+        std::size_t i = 0;
+        const __m256 voffset = _mm256_set1_ps(offset);
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(x + i), voffset));
+        }
+        for (; i < n; ++i) {
+            y[i] = x[i] + offset;
+        }
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_logsumexp(const std::size_t n, const float *x) {
+        float max = avx2_max_f32(n, x);
+        return max + std::log(avx2_sum_exp_f32(n, x, max));
+    }
+
+    FAST_TARGET_AVX2 inline float avx2_log_softmax(const std::size_t n, float *y, const float *x) {
+        float lse = avx2_logsumexp(n, x);
+        avx2_offset_f32(n, y, x, -lse);
+        return lse;
+    }
+
+    /* --------------------------- AVX-512 -------------------------- */
+
+    FAST_TARGET_AVX512 inline __m512 avx512_exp_f32(__m512 x) {
+        const __m512 magic = _mm512_set1_ps(exp_magic);
+        const __m512 offset = _mm512_set1_ps(exp_bias);
+
+        __m512 bits = _mm512_max_ps(_mm512_fmadd_ps(magic, x, offset), _mm512_setzero_ps());
+        bits = _mm512_min_ps(bits, _mm512_set1_ps(exp_bits_max));
+        return _mm512_castsi512_ps(_mm512_cvttps_epi32(bits));
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_log_f32(__m512 x) {
+        const __m512 magic_scale = _mm512_set1_ps(8.26295831757307e-08f);
+        const __m512i offset = _mm512_set1_epi32(0x3f800000);
+
+        __m512i i = _mm512_sub_epi32(_mm512_castps_si512(x), offset);
+        return _mm512_mul_ps(magic_scale, _mm512_cvtepi32_ps(i));
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_log2_minimax_f32(__m512 x) {
+        __m512i i = _mm512_castps_si512(x);
+        __m512 exponent = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(i, 23), _mm512_set1_epi32(127)));
+        __m512 f = _mm512_sub_ps(
+            _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(i, _mm512_set1_epi32(0x007FFFFF)),
+                                                _mm512_set1_epi32(0x3F800000))),
+            _mm512_set1_ps(1.0f));
+
+        __m512 p = _mm512_set1_ps(log2_minimax_5[5]);
+        for (std::size_t k = 5; k-- > 0;) {
+            p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(log2_minimax_5[k]));
+        }
+        return _mm512_add_ps(exponent, p);
+    }
+
+    // Same as avx2_exp2_interp2_f32, vpermps now indexes 16 lanes so the
+    // table is repeated four times
+    FAST_TARGET_AVX512 inline __m512 avx512_exp2_interp2_f32(__m512 x) {
+        const __m512 table = _mm512_setr_ps(
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f,
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f,
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f,
+            1.00000000f, 1.18920712f, 1.41421356f, 1.68179283f);
+        const __m512 slopes = _mm512_sub_ps(_mm512_setr_ps(
+            1.18920712f, 1.41421356f, 1.68179283f, 2.00000000f,
+            1.18920712f, 1.41421356f, 1.68179283f, 2.00000000f,
+            1.18920712f, 1.41421356f, 1.68179283f, 2.00000000f,
+            1.18920712f, 1.41421356f, 1.68179283f, 2.00000000f), table);
+
+        // Also false for NaN, which then comes out as 0 like in the scalar version
+        __mmask16 in_range = _mm512_cmp_ps_mask(x, _mm512_set1_ps(-126.0f), _CMP_GE_OQ);
+        x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-126.0f)), _mm512_set1_ps(127.99999f));
+
+        __m512 scaled_x = _mm512_mul_ps(x, _mm512_set1_ps(4.0f));
+        __m512 floor_x = _mm512_roundscale_ps(scaled_x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        __m512i quarters = _mm512_cvttps_epi32(floor_x);
+        __m512 fraction = _mm512_sub_ps(scaled_x, floor_x);
+
+        __m512 exp2_mantissa = _mm512_fmadd_ps(fraction, _mm512_permutexvar_ps(quarters, slopes),
+                                               _mm512_permutexvar_ps(quarters, table));
+        __m512i exponent = _mm512_slli_epi32(_mm512_srai_epi32(quarters, 2), 23);
+        __m512 result = _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(exp2_mantissa), exponent));
+        return _mm512_maskz_mov_ps(in_range, result);
+    }
+
+    FAST_TARGET_AVX512 inline __m512 avx512_exp_interp2_f32(__m512 x) {
+        const __m512 log2_e = _mm512_set1_ps(1.44269504088896341f);
+        return avx512_exp2_interp2_f32(_mm512_mul_ps(x, log2_e));
+    }
+
+    // Lanes at or past `remaining` are masked off, so loads and stores never
+    // touch memory past the end of the array
+    FAST_TARGET_AVX512 inline __mmask16 avx512_tail_mask(std::size_t remaining) {
+        return remaining >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+    }
+
+    FAST_TARGET_AVX512 inline void avx512_exp_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, avx512_exp_f32(_mm512_loadu_ps(x + i)));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, avx512_exp_f32(_mm512_maskz_loadu_ps(mask, x + i)));
+        }
+    }
+
+    FAST_TARGET_AVX512 inline void avx512_log_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, avx512_log_f32(_mm512_loadu_ps(x + i)));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, avx512_log_f32(_mm512_maskz_loadu_ps(mask, x + i)));
+        }
+    }
+
+    FAST_TARGET_AVX512 inline float avx512_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        std::size_t i = 0;
+        __m512 acc = _mm512_setzero_ps();
+        const __m512 vmax = _mm512_set1_ps(max);
+        for (; i + 15 < n; i += 16) {
+            __m512 val = avx512_exp_f32(_mm512_sub_ps(_mm512_loadu_ps(x + i), vmax));
+            _mm512_storeu_ps(y + i, val);
+            acc = _mm512_add_ps(acc, val);
+        }
+
+        if (i < n) {
+            // The masked off lanes would compute exp(-max), keep them out of the sum
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            __m512 val = avx512_exp_f32(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x + i), vmax));
+            _mm512_mask_storeu_ps(y + i, mask, val);
+            acc = _mm512_mask_add_ps(acc, mask, acc, val);
+        }
+
+        return _mm512_reduce_add_ps(acc);
+    }
+
+    FAST_TARGET_AVX512 inline float avx512_max_f32(const std::size_t n, const float *x) {
+        std::size_t i = 0;
+        __m512 acc = _mm512_set1_ps(-INFINITY);
+        for (; i + 15 < n; i += 16) {
+            acc = _mm512_max_ps(acc, _mm512_loadu_ps(x + i));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            acc = _mm512_mask_max_ps(acc, mask, acc, _mm512_maskz_loadu_ps(mask, x + i));
+        }
+        return _mm512_reduce_max_ps(acc);
+    }
+
+    FAST_TARGET_AVX512 inline void avx512_scale_f32(const std::size_t n, float *y, float scale) {
+        std::size_t i = 0;
+        const __m512 vscale = _mm512_set1_ps(scale);
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(y + i), vscale));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, y + i), vscale));
+        }
+    }
+
+    FAST_TARGET_AVX512 inline float avx512_sum_exp_f32(const std::size_t n, const float *x, float max) {
+        std::size_t i = 0;
+        __m512 acc = _mm512_setzero_ps();
+        const __m512 vmax = _mm512_set1_ps(max);
+        for (; i + 15 < n; i += 16) {
+            acc = _mm512_add_ps(acc, avx512_exp_f32(_mm512_sub_ps(_mm512_loadu_ps(x + i), vmax)));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            __m512 val = avx512_exp_f32(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x + i), vmax));
+            acc = _mm512_mask_add_ps(acc, mask, acc, val);
+        }
+        return _mm512_reduce_add_ps(acc);
+    }
+
+    FAST_TARGET_AVX512 inline void avx512_offset_f32(const std::size_t n, float *y, const float *x, float offset) {
+        std::size_t i = 0;
+        const __m512 voffset = _mm512_set1_ps(offset);
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(x + i), voffset));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, x + i), voffset));
+        }
+    }
+
+    /* -------------------------- exp tiers ------------------------- */
+
+    // fast::exp<Tier> lets each call site pick how much accuracy it pays
+    // for. Every tier has a scalar, an AVX2 and an AVX-512 form and
+    // documents its max relative error over [-87, 88].
+    //
+    //   exp_tier::schraudolph   3.0e-2   1 fma, the plain fast::exp
+    //   exp_tier::interp2       3.8e-3   2-bit table lerp, see exp2_interp2
+    //   exp_tier::correct1      1.7e-3   floor + degree 2 mantissa polynomial
+    //   exp_tier::correct2      7.9e-5   floor + degree 3
+    //   exp_tier::correct3      6.4e-6   floor + degree 4
+    //   exp_tier::precise       1.2e-7   Cody-Waite reduction + degree 6, ~1 ulp
+    //
+    // The correct* tiers are the Schraudolph split of x * log2(e) into an
+    // exponent and a mantissa fraction f, with 2^f taken from a minimax
+    // polynomial instead of the linear 1 + f. At degree 4 the rounding of
+    // x * log2(e) itself starts to dominate for large |x|, which is why
+    // precise reduces x with a split ln(2) instead. Except for schraudolph,
+    // inputs below the float range flush to zero.
+    namespace exp_tier {
+
+        struct schraudolph {
+            static constexpr float max_rel_error = 3.0e-2f;
+
+            static float scalar(float x) { return fast::exp(x); }
+            FAST_TARGET_AVX2 static __m256 avx2(__m256 x) { return avx2_exp_f32(x); }
+            FAST_TARGET_AVX512 static __m512 avx512(__m512 x) { return avx512_exp_f32(x); }
+        };
+
+        struct interp2 {
+            static constexpr float max_rel_error = 3.8e-3f;
+
+            static float scalar(float x) { return fast::exp_interp2(x); }
+            FAST_TARGET_AVX2 static __m256 avx2(__m256 x) { return avx2_exp_interp2_f32(x); }
+            FAST_TARGET_AVX512 static __m512 avx512(__m512 x) { return avx512_exp_interp2_f32(x); }
+        };
+
+        // Minimax (relative error) fits of 2^f on [0, 1), lowest order first.
+        // Generated by remez.hpp, test_remez checks they still match.
+        constexpr std::array<float, 3> exp2_minimax_2 = {
+            1.00172472e+00f, 6.57636225e-01f, 3.37189466e-01f};
+        constexpr std::array<float, 4> exp2_minimax_3 = {
+            9.99925196e-01f, 6.95833564e-01f, 2.26067156e-01f, 7.80245289e-02f};
+        constexpr std::array<float, 5> exp2_minimax_4 = {
+            1.00000262e+00f, 6.93003833e-01f, 2.41442755e-01f, 5.20114638e-02f, 1.35341659e-02f};
+
+        template<const auto& Coefficients>
+        struct exp_poly {
+            static constexpr std::size_t degree = Coefficients.size() - 1;
+
+            static float scalar(float t) {
+                float p = Coefficients[degree];
+                for (std::size_t i = degree; i-- > 0;) {
+                    p = p * t + Coefficients[i];
+                }
+                return p;
+            }
+
+            FAST_TARGET_AVX2 static __m256 avx2(__m256 t) {
+                __m256 p = _mm256_set1_ps(Coefficients[degree]);
+                for (std::size_t i = degree; i-- > 0;) {
+                    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(Coefficients[i]));
+                }
+                return p;
+            }
+
+            FAST_TARGET_AVX512 static __m512 avx512(__m512 t) {
+                __m512 p = _mm512_set1_ps(Coefficients[degree]);
+                for (std::size_t i = degree; i-- > 0;) {
+                    p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(Coefficients[i]));
+                }
+                return p;
+            }
+        };
+
+        template<typename Poly, float MaxRelError>
+        struct corrected {
+            static constexpr float max_rel_error = MaxRelError;
+
+            static float scalar(float x) {
+                const float log2_e = 1.44269504088896341f;
+                float t = x * log2_e;
+                if (!(t >= -126.0f)) {
+                    return 0.0f;
+                }
+                t = std::min(t, 127.99999f);
+
+                float floor_t = std::floor(t);
+                float mantissa = Poly::scalar(t - floor_t);
+                return std::bit_cast<float>(std::bit_cast<int32_t>(mantissa) + (static_cast<int32_t>(floor_t) << 23));
+            }
+
+            FAST_TARGET_AVX2 static __m256 avx2(__m256 x) {
+                const __m256 log2_e = _mm256_set1_ps(1.44269504088896341f);
+                __m256 t = _mm256_mul_ps(x, log2_e);
+                __m256 in_range = _mm256_cmp_ps(t, _mm256_set1_ps(-126.0f), _CMP_GE_OQ);
+                t = _mm256_min_ps(_mm256_max_ps(t, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.99999f));
+
+                __m256 floor_t = _mm256_floor_ps(t);
+                __m256 mantissa = Poly::avx2(_mm256_sub_ps(t, floor_t));
+                __m256i exponent = _mm256_slli_epi32(_mm256_cvttps_epi32(floor_t), 23);
+                __m256 result = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(mantissa), exponent));
+                return _mm256_and_ps(result, in_range);
+            }
+
+            FAST_TARGET_AVX512 static __m512 avx512(__m512 x) {
+                const __m512 log2_e = _mm512_set1_ps(1.44269504088896341f);
+                __m512 t = _mm512_mul_ps(x, log2_e);
+                __mmask16 in_range = _mm512_cmp_ps_mask(t, _mm512_set1_ps(-126.0f), _CMP_GE_OQ);
+                t = _mm512_min_ps(_mm512_max_ps(t, _mm512_set1_ps(-126.0f)), _mm512_set1_ps(127.99999f));
+
+                __m512 floor_t = _mm512_roundscale_ps(t, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                __m512 mantissa = Poly::avx512(_mm512_sub_ps(t, floor_t));
+                __m512i exponent = _mm512_slli_epi32(_mm512_cvttps_epi32(floor_t), 23);
+                __m512 result = _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(mantissa), exponent));
+                return _mm512_maskz_mov_ps(in_range, result);
+            }
+        };
+
+        using correct1 = corrected<exp_poly<exp2_minimax_2>, 1.7e-3f>;
+        using correct2 = corrected<exp_poly<exp2_minimax_3>, 7.9e-5f>;
+        using correct3 = corrected<exp_poly<exp2_minimax_4>, 6.4e-6f>;
+
+        // Cephes expf: x = n ln(2) + r with ln(2) split in two so r is exact,
+        // then e^r from a degree 6 polynomial on [-ln(2)/2, ln(2)/2]
+        struct precise {
+            static constexpr float max_rel_error = 1.2e-7f;
+
+            // Anything above ~88.72 overflows to inf through the scaling below,
+            // the clamp only keeps n representable
+            static constexpr float max_x = 100.0f;
+            static constexpr float min_x = -87.3365479f;
+            static constexpr float ln2_hi = 0.693359375f;
+            static constexpr float ln2_lo = -2.12194440e-4f;
+            static constexpr std::array<float, 6> coefficients = {
+                5.0000001201e-1f, 1.6666665459e-1f, 4.1665795894e-2f,
+                8.3334519073e-3f, 1.3981999507e-3f, 1.9875691500e-4f};
+
+            static float scalar(float x) {
+                if (!(x >= min_x)) {
+                    return 0.0f;
+                }
+                x = std::min(x, max_x);
+
+                float n = std::nearbyint(x * 1.44269504088896341f);
+                float r = x - n * ln2_hi - n * ln2_lo;
+
+                float p = coefficients[5];
+                for (std::size_t i = 5; i-- > 0;) {
+                    p = p * r + coefficients[i];
+                }
+                p = p * r * r + r + 1.0f;
+
+                // 2^n in two halves, near the top of the range p * 2^128 is
+                // still finite and 2^128 itself isn't
+                int32_t half = static_cast<int32_t>(n) >> 1;
+                float scale_lo = std::bit_cast<float>((half + 127) << 23);
+                float scale_hi = std::bit_cast<float>((static_cast<int32_t>(n) - half + 127) << 23);
+                return p * scale_lo * scale_hi;
+            }
+
+            FAST_TARGET_AVX2 static __m256 avx2(__m256 x) {
+                __m256 in_range = _mm256_cmp_ps(x, _mm256_set1_ps(min_x), _CMP_GE_OQ);
+                x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(min_x)), _mm256_set1_ps(max_x));
+
+                __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+                                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_hi), x);
+                r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_lo), r);
+
+                __m256 p = _mm256_set1_ps(coefficients[5]);
+                for (std::size_t i = 5; i-- > 0;) {
+                    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(coefficients[i]));
+                }
+                p = _mm256_fmadd_ps(_mm256_mul_ps(p, r), r, _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+                const __m256i bias = _mm256_set1_epi32(127);
+                __m256i ni = _mm256_cvtps_epi32(n);
+                __m256i half = _mm256_srai_epi32(ni, 1);
+                __m256 scale_lo = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(half, bias), 23));
+                __m256 scale_hi = _mm256_castsi256_ps(_mm256_slli_epi32(
+                    _mm256_add_epi32(_mm256_sub_epi32(ni, half), bias), 23));
+                __m256 result = _mm256_mul_ps(_mm256_mul_ps(p, scale_lo), scale_hi);
+                return _mm256_and_ps(result, in_range);
+            }
+
+            FAST_TARGET_AVX512 static __m512 avx512(__m512 x) {
+                __mmask16 in_range = _mm512_cmp_ps_mask(x, _mm512_set1_ps(min_x), _CMP_GE_OQ);
+                x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(min_x)), _mm512_set1_ps(max_x));
+
+                __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+                                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_hi), x);
+                r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_lo), r);
+
+                __m512 p = _mm512_set1_ps(coefficients[5]);
+                for (std::size_t i = 5; i-- > 0;) {
+                    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(coefficients[i]));
+                }
+                p = _mm512_fmadd_ps(_mm512_mul_ps(p, r), r, _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+
+                const __m512i bias = _mm512_set1_epi32(127);
+                __m512i ni = _mm512_cvtps_epi32(n);
+                __m512i half = _mm512_srai_epi32(ni, 1);
+                __m512 scale_lo = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(half, bias), 23));
+                __m512 scale_hi = _mm512_castsi512_ps(_mm512_slli_epi32(
+                    _mm512_add_epi32(_mm512_sub_epi32(ni, half), bias), 23));
+                __m512 result = _mm512_mul_ps(_mm512_mul_ps(p, scale_lo), scale_hi);
+                return _mm512_maskz_mov_ps(in_range, result);
+            }
+        };
+    }
+
+    template<typename Tier>
+    inline float exp(float x) {
+        return Tier::scalar(x);
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX2 inline __m256 avx2_exp_f32(__m256 x) {
+        return Tier::avx2(x);
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX2 inline void avx2_exp_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, Tier::avx2(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = Tier::scalar(x[i]);
+        }
+    }
+
+    template<typename Tier>
+    inline float scalar_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        float sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            float val = Tier::scalar(x[i] - max);
+            sum += val;
+            y[i] = val;
+        }
+        return sum;
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX2 inline float avx2_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        std::size_t i = 0;
+        __m256 acc = _mm256_setzero_ps();
+        const __m256 vmax = _mm256_set1_ps(max);
+        for(; i + 7 < n; i += 8) {
+            __m256 val = Tier::avx2(_mm256_sub_ps(_mm256_loadu_ps(x+i), vmax));
+            _mm256_storeu_ps(y + i, val);
+            acc = _mm256_add_ps(acc, val);
+        }
+
+        float sum = avx2_reduce_add_ps(acc);
+        for (; i < n; ++i) {
+            float val = Tier::scalar(x[i] - max);
+            sum += val;
+            y[i] = val;
+        }
+
+        return sum;
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX512 inline __m512 avx512_exp_f32(__m512 x) {
+        return Tier::avx512(x);
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX512 inline void avx512_exp_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 15 < n; i += 16) {
+            _mm512_storeu_ps(y + i, Tier::avx512(_mm512_loadu_ps(x + i)));
+        }
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            _mm512_mask_storeu_ps(y + i, mask, Tier::avx512(_mm512_maskz_loadu_ps(mask, x + i)));
+        }
+    }
+
+    template<typename Tier>
+    FAST_TARGET_AVX512 inline float avx512_softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        std::size_t i = 0;
+        __m512 acc = _mm512_setzero_ps();
+        const __m512 vmax = _mm512_set1_ps(max);
+        for (; i + 15 < n; i += 16) {
+            __m512 val = Tier::avx512(_mm512_sub_ps(_mm512_loadu_ps(x + i), vmax));
+            _mm512_storeu_ps(y + i, val);
+            acc = _mm512_add_ps(acc, val);
+        }
+
+        if (i < n) {
+            const __mmask16 mask = avx512_tail_mask(n - i);
+            __m512 val = Tier::avx512(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x + i), vmax));
+            _mm512_mask_storeu_ps(y + i, mask, val);
+            acc = _mm512_mask_add_ps(acc, mask, acc, val);
+        }
+
+        return _mm512_reduce_add_ps(acc);
+    }
+
+    /* -------------------------- dispatch -------------------------- */
+
+    enum class isa { scalar, sse41, avx2, avx512 };
+
+    inline const char *isa_name(isa level) {
+        switch (level) {
+            case isa::sse41: return "sse4.1";
+            case isa::avx2: return "avx2+fma";
+            case isa::avx512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    inline bool isa_supported(isa level) {
+        __builtin_cpu_init();
+        switch (level) {
+            case isa::avx512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+                    && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case isa::avx2:
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case isa::sse41:
+                return __builtin_cpu_supports("sse4.1");
+            default:
+                return true;
+        }
+    }
+
+    inline isa detect_isa() {
+        for (isa level : {isa::avx512, isa::avx2, isa::sse41}) {
+            if (isa_supported(level)) {
+                return level;
+            }
+        }
+        return isa::scalar;
+    }
+
+    struct kernel_table {
+        isa level;
+        void (*exp_f32)(std::size_t n, float *y, const float *x);
+        void (*log_f32)(std::size_t n, float *y, const float *x);
+        // Writes exp(x - max) to y and returns the sum
+        float (*softmax_f32)(std::size_t n, float *y, const float *x, float max);
+        float (*max_f32)(std::size_t n, const float *x);
+        // y *= scale, in place
+        void (*scale_f32)(std::size_t n, float *y, float scale);
+        // Sum of exp(x - max) without storing the exps
+        float (*sum_exp_f32)(std::size_t n, const float *x, float max);
+        // y = x + offset, y may alias x
+        void (*offset_f32)(std::size_t n, float *y, const float *x, float offset);
+    };
+
+#define FAST_KERNEL_TABLE(level, prefix) \
+    kernel_table { level, prefix##_exp_f32, prefix##_log_f32, prefix##_softmax_f32, \
+                   prefix##_max_f32, prefix##_scale_f32, prefix##_sum_exp_f32, \
+                   prefix##_offset_f32 }
+
+    // Does not check that the host supports `level`, see isa_supported()
+    inline kernel_table make_kernel_table(isa level) {
+        switch (level) {
+            case isa::avx512: return FAST_KERNEL_TABLE(isa::avx512, avx512);
+            case isa::avx2: return FAST_KERNEL_TABLE(isa::avx2, avx2);
+            case isa::sse41: return FAST_KERNEL_TABLE(isa::sse41, sse41);
+            default: return FAST_KERNEL_TABLE(isa::scalar, scalar);
+        }
+    }
+
+#undef FAST_KERNEL_TABLE
+
+    // cpuid is only queried the first time this is called
+    inline const kernel_table& kernels() {
+        static const kernel_table table = make_kernel_table(detect_isa());
+        return table;
+    }
+
+    inline void exp_f32(const std::size_t n, float *y, const float *x) {
+        kernels().exp_f32(n, y, x);
+    }
+
+    inline void log_f32(const std::size_t n, float *y, const float *x) {
+        kernels().log_f32(n, y, x);
+    }
+
+    inline float softmax_f32(const std::size_t n, float *y, const float *x, float max) {
+        return kernels().softmax_f32(n, y, x, max);
+    }
+
+    // Normalized softmax of x written to y, which may alias x. Makes three
+    // passes (max, exp + sum, scale) and never allocates. Returns the sum of
+    // exp(x - max) before normalization.
+    inline float softmax(const std::size_t n, float *y, const float *x) {
+        const kernel_table& k = kernels();
+        float max = k.max_f32(n, x);
+        float sum = k.softmax_f32(n, y, x, max);
+        k.scale_f32(n, y, 1.0f / sum);
+        return sum;
+    }
+
+    template<typename Tier>
+    inline void exp(const std::size_t n, float *y, const float *x) {
+        if (kernels().level >= isa::avx512) {
+            avx512_exp_f32<Tier>(n, y, x);
+        } else if (kernels().level >= isa::avx2) {
+            avx2_exp_f32<Tier>(n, y, x);
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                y[i] = Tier::scalar(x[i]);
+            }
+        }
+    }
+
+    // Same as softmax() with the exps taken from the given exp tier
+    template<typename Tier>
+    inline float softmax(const std::size_t n, float *y, const float *x) {
+        const kernel_table& k = kernels();
+        float max = k.max_f32(n, x);
+        float sum = k.level >= isa::avx512 ? avx512_softmax_f32<Tier>(n, y, x, max)
+                  : k.level >= isa::avx2 ? avx2_softmax_f32<Tier>(n, y, x, max)
+                                         : scalar_softmax_f32<Tier>(n, y, x, max);
+        k.scale_f32(n, y, 1.0f / sum);
+        return sum;
+    }
+
+    // For when the ~3% error of the Schraudolph exp is too much
+    inline float softmax_interp2(const std::size_t n, float *y, const float *x) {
+        return fast::softmax<exp_tier::interp2>(n, y, x);
+    }
+
+    inline float vec_softmax(std::vector<float>& input) {
+        return fast::softmax(input.size(), input.data(), input.data());
+    }
+
+    // log(sum(exp(x))), computed as max + log(sum(exp(x - max))) so it can't
+    // overflow. Only the single log of the sum is a real transcendental call.
+    inline float scalar_logsumexp(const std::size_t n, const float *x) {
+        float max = scalar_max_f32(n, x);
+        return max + std::log(scalar_sum_exp_f32(n, x, max));
+    }
+
+    // Writes x - logsumexp(x) to y (which may alias x), returns logsumexp(x)
+    inline float scalar_log_softmax(const std::size_t n, float *y, const float *x) {
+        float lse = scalar_logsumexp(n, x);
+        scalar_offset_f32(n, y, x, -lse);
+        return lse;
+    }
+
+    inline float logsumexp(const std::size_t n, const float *x) {
+        const kernel_table& k = kernels();
+        float max = k.max_f32(n, x);
+        return max + std::log(k.sum_exp_f32(n, x, max));
+    }
+
+    inline float log_softmax(const std::size_t n, float *y, const float *x) {
+        float lse = fast::logsumexp(n, x);
+        kernels().offset_f32(n, y, x, -lse);
+        return lse;
+    }
+
+    // Streaming softmax: tracks the running max and a sum of exp(x - max)
+    // that is rescaled whenever the max grows, so chunks of any size can be
+    // fed as they arrive and each element is only read from memory once.
+    // The rescale factor uses std::exp, the Schraudolph error would compound
+    // on every max increase; it is one call per increase, not per element.
+    class online_softmax {
+    public:
+        // Large chunks are split into blocks that stay in L1 between the
+        // block max and the exp pass
+        static constexpr std::size_t block_size = 2048;
+
+        void update(const std::size_t n, const float *x) {
+            const kernel_table& k = kernels();
+            for (std::size_t i = 0; i < n; i += block_size) {
+                const std::size_t len = std::min(block_size, n - i);
+                float block_max = k.max_f32(len, x + i);
+                if (block_max > running_max) {
+                    running_sum *= std::exp(running_max - block_max);
+                    running_max = block_max;
+                }
+                running_sum += k.sum_exp_f32(len, x + i, running_max);
+            }
+        }
+
+        void update(float x) {
+            update(1, &x);
+        }
+
+        // Combines the state of another stream, e.g. one computed on
+        // another thread over a different part of the same row
+        void merge(const online_softmax& other) {
+            // An empty stream would make -inf - -inf below
+            if (other.running_max == -INFINITY) {
+                return;
+            }
+            if (other.running_max > running_max) {
+                running_sum = running_sum * std::exp(running_max - other.running_max) + other.running_sum;
+                running_max = other.running_max;
+            } else {
+                running_sum += other.running_sum * std::exp(other.running_max - running_max);
+            }
+        }
+
+        float max() const { return running_max; }
+        float sum() const { return running_sum; }
+        float logsumexp() const { return running_max + std::log(running_sum); }
+
+        // Writes softmax(x) to y (which may alias x) using the accumulated
+        // state, x must be the concatenation of everything passed to update()
+        void normalize(const std::size_t n, float *y, const float *x) const {
+            const kernel_table& k = kernels();
+            k.softmax_f32(n, y, x, running_max);
+            k.scale_f32(n, y, 1.0f / running_sum);
+        }
+
+        void reset() {
+            running_max = -INFINITY;
+            running_sum = 0.0f;
+        }
+
+    private:
+        float running_max = -INFINITY;
+        float running_sum = 0.0f;
+    };
+
+    // Row-wise softmax over a rows x cols matrix whose rows start `stride`
+    // floats apart, in and out may be the same buffer. Rows are split
+    // across the pool, with short rows batched into one task until a task
+    // covers about `task_elements` floats so per-task overhead stays small.
+    inline void softmax_rows(const std::size_t rows, const std::size_t cols, const std::size_t stride,
+                             const float *in, float *out, thread_pool& pool = thread_pool::global()) {
+        constexpr std::size_t task_elements = 16 * 1024;
+
+        std::size_t rows_per_task = std::max<std::size_t>(1, task_elements / std::max<std::size_t>(cols, 1));
+        // ...but never so few tasks that some threads sit idle
+        rows_per_task = std::min(rows_per_task, std::max<std::size_t>(1, rows / pool.size()));
+        const std::size_t tasks = (rows + rows_per_task - 1) / rows_per_task;
+
+        pool.parallel_for(tasks, [&](std::size_t task) {
+            const std::size_t first = task * rows_per_task;
+            const std::size_t last = std::min(rows, first + rows_per_task);
+            for (std::size_t r = first; r < last; ++r) {
+                fast::softmax(cols, out + r * stride, in + r * stride);
+            }
+        });
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+#include "lut_interp.hpp"
+
+namespace fast {
+
+    // x^y from a bilinear lerp of a (2^5 + 1) x (2^5 + 1) table over
+    // x in [0, 1], y in [0.5, 4], build_pow_lut/approx_pow_2d in
+    // pow_approximation.py. Inputs outside the table are clamped. Row
+    // ix holds x = ix / 32 so the four corners of a cell are index,
+    // index + 1 (next y) and index + stride, index + stride + 1 (next x).
+    // Max abs error is ~1.5e-3, under half an 8-bit step, except for y < 1
+    // near x = 0 where x^y is steep (~4e-2 at y = 0.5). Relative error is
+    // poor for small x, use pow_logexp when that matters.
+    struct pow_lut_table {
+        static constexpr unsigned bits = 5;
+        static constexpr std::size_t cells = std::size_t(1) << bits;
+        static constexpr std::size_t stride = cells + 1;
+        static constexpr float x_lo = 0.0f;
+        static constexpr float x_hi = 1.0f;
+        static constexpr float y_lo = 0.5f;
+        static constexpr float y_hi = 4.0f;
+        static constexpr float x_scale = cells / (x_hi - x_lo);
+        static constexpr float y_scale = cells / (y_hi - y_lo);
+
+        alignas(32) std::array<float, stride * stride> values;
+
+        static constexpr pow_lut_table build() {
+            pow_lut_table t{};
+            for (std::size_t ix = 0; ix < stride; ++ix) {
+                double x = x_lo + double(x_hi - x_lo) * ix / cells;
+                for (std::size_t iy = 0; iy < stride; ++iy) {
+                    double y = y_lo + double(y_hi - y_lo) * iy / cells;
+                    // cmath::log never terminates for 0, and 0^y is 0 for y > 0
+                    t.values[ix * stride + iy] = x == 0.0 ? 0.0f : static_cast<float>(cmath::exp(y * cmath::log(x)));
+                }
+            }
+            return t;
+        }
+    };
+
+    inline constexpr pow_lut_table pow_lut_values = pow_lut_table::build();
+
+    inline float pow_lut(float x, float y) {
+        using table = pow_lut_table;
+        x = std::min(std::max(x, table::x_lo), table::x_hi);
+        y = std::min(std::max(y, table::y_lo), table::y_hi);
+
+        float sx = (x - table::x_lo) * table::x_scale;
+        float sy = (y - table::y_lo) * table::y_scale;
+        std::size_t ix = std::min(static_cast<std::size_t>(sx), table::cells - 1);
+        std::size_t iy = std::min(static_cast<std::size_t>(sy), table::cells - 1);
+        float fx = sx - static_cast<float>(ix);
+        float fy = sy - static_cast<float>(iy);
+
+        const float *c = pow_lut_values.values.data() + ix * table::stride + iy;
+        float c0 = c[0] + fy * (c[1] - c[0]);
+        float c1 = c[table::stride] + fy * (c[table::stride + 1] - c[table::stride]);
+        return c0 + fx * (c1 - c0);
+    }
+
+    // x^y = 2^(y * log2(x)) with the 2-bit interpolated log2 and exp2,
+    // approx_pow_via_log_exp in pow_approximation.py. Any y, x > 0, max
+    // rel error grows with |y * log2(x)|, ~1.4e-2 for x in (0, 1] at y = 2.2.
+    inline float pow_logexp(float x, float y) {
+        return exp2_interp2(y * approx_log2_interpolated_2bit(x));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_pow_lut_f32(__m256 x, __m256 y) {
+        using table = pow_lut_table;
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(table::x_lo)), _mm256_set1_ps(table::x_hi));
+        y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(table::y_lo)), _mm256_set1_ps(table::y_hi));
+
+        __m256 sx = _mm256_mul_ps(_mm256_sub_ps(x, _mm256_set1_ps(table::x_lo)), _mm256_set1_ps(table::x_scale));
+        __m256 sy = _mm256_mul_ps(_mm256_sub_ps(y, _mm256_set1_ps(table::y_lo)), _mm256_set1_ps(table::y_scale));
+        const __m256i last = _mm256_set1_epi32(table::cells - 1);
+        __m256i ix = _mm256_min_epi32(_mm256_cvttps_epi32(sx), last);
+        __m256i iy = _mm256_min_epi32(_mm256_cvttps_epi32(sy), last);
+        __m256 fx = _mm256_sub_ps(sx, _mm256_cvtepi32_ps(ix));
+        __m256 fy = _mm256_sub_ps(sy, _mm256_cvtepi32_ps(iy));
+
+        const float *base = pow_lut_values.values.data();
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(ix, _mm256_set1_epi32(table::stride)), iy);
+        __m256i next_x = _mm256_add_epi32(index, _mm256_set1_epi32(table::stride));
+        __m256 c00 = _mm256_i32gather_ps(base, index, 4);
+        __m256 c01 = _mm256_i32gather_ps(base + 1, index, 4);
+        __m256 c10 = _mm256_i32gather_ps(base, next_x, 4);
+        __m256 c11 = _mm256_i32gather_ps(base + 1, next_x, 4);
+
+        __m256 c0 = _mm256_fmadd_ps(fy, _mm256_sub_ps(c01, c00), c00);
+        __m256 c1 = _mm256_fmadd_ps(fy, _mm256_sub_ps(c11, c10), c10);
+        return _mm256_fmadd_ps(fx, _mm256_sub_ps(c1, c0), c0);
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_pow_logexp_f32(__m256 x, __m256 y) {
+        return avx2_exp2_interp2_f32(_mm256_mul_ps(y, avx2_log2_interp2_f32(x)));
+    }
+
+    // Array forms raise every x[i] to one fixed exponent, the gamma
+    // correction case: out[i] = x[i]^y
+    inline void scalar_pow_lut_f32(const std::size_t n, float *out, const float *x, float y) {
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = fast::pow_lut(x[i], y);
+        }
+    }
+
+    inline void scalar_pow_logexp_f32(const std::size_t n, float *out, const float *x, float y) {
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = fast::pow_logexp(x[i], y);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_pow_lut_f32(const std::size_t n, float *out, const float *x, float y) {
+        const __m256 vy = _mm256_set1_ps(y);
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(out + i, avx2_pow_lut_f32(_mm256_loadu_ps(x + i), vy));
+        }
+        for (; i < n; ++i) {
+            out[i] = fast::pow_lut(x[i], y);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_pow_logexp_f32(const std::size_t n, float *out, const float *x, float y) {
+        const __m256 vy = _mm256_set1_ps(y);
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(out + i, avx2_pow_logexp_f32(_mm256_loadu_ps(x + i), vy));
+        }
+        for (; i < n; ++i) {
+            out[i] = fast::pow_logexp(x[i], y);
+        }
+    }
+
+    inline void pow_lut(const std::size_t n, float *out, const float *x, float y) {
+        if (kernels().level >= isa::avx2) {
+            avx2_pow_lut_f32(n, out, x, y);
+        } else {
+            scalar_pow_lut_f32(n, out, x, y);
+        }
+    }
+
+    inline void pow_logexp(const std::size_t n, float *out, const float *x, float y) {
+        if (kernels().level >= isa::avx2) {
+            avx2_pow_logexp_f32(n, out, x, y);
+        } else {
+            scalar_pow_logexp_f32(n, out, x, y);
+        }
+    }
+}
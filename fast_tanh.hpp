@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+
+namespace fast {
+
+    // tanh(x) = sign(x) * (1 - 2 / (e^(2|x|) + 1)), approx_tanh in
+    // tanh_lookup_table.py. That form cancels badly near zero so small |x|
+    // uses the Taylor series instead, and past 9 tanh rounds to 1.0f anyway.
+    // With the default exp tier the max relative error is ~1.3e-4. NaN is
+    // passed through, the clamp would otherwise turn it into a finite value.
+    constexpr float tanh_series_cutoff = 0.25f;
+    constexpr float tanh_saturation = 9.0f;
+
+    template<typename Tier = exp_tier::correct2>
+    inline float tanh(float x) {
+        if (std::isnan(x)) {
+            return x;
+        }
+        float ax = std::min(std::fabs(x), tanh_saturation);
+        float result;
+        if (ax < tanh_series_cutoff) {
+            float x2 = ax * ax;
+            result = ax * (1.0f + x2 * (-1.0f / 3.0f + x2 * (2.0f / 15.0f + x2 * (-17.0f / 315.0f))));
+        } else {
+            result = 1.0f - 2.0f * fast::rcp(Tier::scalar(2.0f * ax) + 1.0f);
+        }
+        return std::copysign(result, x);
+    }
+
+    // atanh(x) = 0.5 * ln((1 + x) / (1 - x)), approx_arctanh in
+    // tanh_lookup_table.py, with the Taylor series near zero. |x| is
+    // clamped just below 1 so the result stays finite (~8.66 at the clamp).
+    // Max relative error is ~1.6e-5. NaN is passed through like in tanh.
+    constexpr float atanh_series_cutoff = 0.25f;
+    constexpr float atanh_limit = 0.99999994f;
+
+    inline float atanh(float x) {
+        if (std::isnan(x)) {
+            return x;
+        }
+        const float half_ln2 = 0.34657359027997264f;
+        float ax = std::min(std::fabs(x), atanh_limit);
+        float result;
+        if (ax < atanh_series_cutoff) {
+            float x2 = ax * ax;
+            result = ax * (1.0f + x2 * (1.0f / 3.0f + x2 * (1.0f / 5.0f + x2 * (1.0f / 7.0f))));
+        } else {
+            result = half_ln2 * fast::log2_minimax((1.0f + ax) * fast::rcp(1.0f - ax));
+        }
+        return std::copysign(result, x);
+    }
+
+    template<typename Tier = exp_tier::correct2>
+    FAST_TARGET_AVX2 inline __m256 avx2_tanh_f32(__m256 x) {
+        const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+        __m256 sign = _mm256_and_ps(x, sign_mask);
+        __m256 ax = _mm256_min_ps(_mm256_andnot_ps(sign_mask, x), _mm256_set1_ps(tanh_saturation));
+
+        __m256 x2 = _mm256_mul_ps(ax, ax);
+        __m256 series = _mm256_fmadd_ps(x2, _mm256_set1_ps(-17.0f / 315.0f), _mm256_set1_ps(2.0f / 15.0f));
+        series = _mm256_fmadd_ps(x2, series, _mm256_set1_ps(-1.0f / 3.0f));
+        series = _mm256_fmadd_ps(x2, series, _mm256_set1_ps(1.0f));
+        series = _mm256_mul_ps(ax, series);
+
+        __m256 e2x = Tier::avx2(_mm256_add_ps(ax, ax));
+        __m256 r = avx2_rcp_f32(_mm256_add_ps(e2x, _mm256_set1_ps(1.0f)));
+        __m256 result = _mm256_fnmadd_ps(_mm256_set1_ps(2.0f), r, _mm256_set1_ps(1.0f));
+
+        __m256 use_series = _mm256_cmp_ps(ax, _mm256_set1_ps(tanh_series_cutoff), _CMP_LT_OQ);
+        result = _mm256_blendv_ps(result, series, use_series);
+        result = _mm256_or_ps(result, sign);
+        return _mm256_blendv_ps(result, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_atanh_f32(__m256 x) {
+        const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        __m256 sign = _mm256_and_ps(x, sign_mask);
+        __m256 ax = _mm256_min_ps(_mm256_andnot_ps(sign_mask, x), _mm256_set1_ps(atanh_limit));
+
+        __m256 x2 = _mm256_mul_ps(ax, ax);
+        __m256 series = _mm256_fmadd_ps(x2, _mm256_set1_ps(1.0f / 7.0f), _mm256_set1_ps(1.0f / 5.0f));
+        series = _mm256_fmadd_ps(x2, series, _mm256_set1_ps(1.0f / 3.0f));
+        series = _mm256_fmadd_ps(x2, series, one);
+        series = _mm256_mul_ps(ax, series);
+
+        __m256 ratio = _mm256_mul_ps(_mm256_add_ps(one, ax), avx2_rcp_f32(_mm256_sub_ps(one, ax)));
+        __m256 result = _mm256_mul_ps(_mm256_set1_ps(0.34657359027997264f), avx2_log2_minimax_f32(ratio));
+
+        __m256 use_series = _mm256_cmp_ps(ax, _mm256_set1_ps(atanh_series_cutoff), _CMP_LT_OQ);
+        result = _mm256_blendv_ps(result, series, use_series);
+        result = _mm256_or_ps(result, sign);
+        return _mm256_blendv_ps(result, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+    }
+
+    template<typename Tier = exp_tier::correct2>
+    inline void scalar_tanh_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::tanh<Tier>(x[i]);
+        }
+    }
+
+    inline void scalar_atanh_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::atanh(x[i]);
+        }
+    }
+
+    template<typename Tier = exp_tier::correct2>
+    FAST_TARGET_AVX2 inline void avx2_tanh_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_tanh_f32<Tier>(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::tanh<Tier>(x[i]);
+        }
+    }
+
+    FAST_TARGET_AVX2 inline void avx2_atanh_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_atanh_f32(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::atanh(x[i]);
+        }
+    }
+
+    template<typename Tier = exp_tier::correct2>
+    inline void tanh(const std::size_t n, float *y, const float *x) {
+        if (kernels().level >= isa::avx2) {
+            avx2_tanh_f32<Tier>(n, y, x);
+        } else {
+            scalar_tanh_f32<Tier>(n, y, x);
+        }
+    }
+
+    inline void atanh(const std::size_t n, float *y, const float *x) {
+        if (kernels().level >= isa::avx2) {
+            avx2_atanh_f32(n, y, x);
+        } else {
+            scalar_atanh_f32(n, y, x);
+        }
+    }
+}
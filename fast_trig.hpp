@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+#include "lut_interp.hpp"
+
+namespace fast {
+
+    // sin(u * pi / 2) for u in [0, 1], the quarter wave from sin_lookup_table.py
+    struct quarter_sine {
+        constexpr double operator()(double u) const { return cmath::sin(u * cmath::pi / 2); }
+    };
+
+    template<unsigned Bits>
+    using quarter_sine_lut = lut_interp<quarter_sine, Bits, domain<0.0, 1.0>>;
+
+    // x = q * pi/2 + r, with pi/2 split Cody-Waite style so q * pio2_1 is
+    // exact. The reduction adds no visible error up to |x| ~ 1000, at 8192
+    // it is ~6e-5 and it keeps growing with |x| past that.
+    constexpr float two_over_pi = 0.636619772367581343f;
+    constexpr float pio2_1 = 1.5703125f;
+    constexpr float pio2_2 = 4.837512969970703125e-4f;
+    constexpr float pio2_3 = 7.54978995489188216e-8f;
+
+    // Reduces x to a quadrant and u = r / (pi/2) in [0, 1]. x * 2/pi can
+    // round up onto an integer, leaving r slightly negative, so that case
+    // steps back a quadrant instead of being clamped to 0 by the table.
+    //
+    // Only q mod 4 is used, and it is taken while q is still a float so the
+    // cast is defined for every input. For NaN and inf it is NaN and the
+    // quadrant is 0. Past |x| ~ 1e5 the result is finite but meaningless.
+    inline float reduce_quadrant(float x, int32_t& quadrant) {
+        float q = std::floor(x * two_over_pi);
+        float r = x - q * pio2_1;
+        r -= q * pio2_2;
+        r -= q * pio2_3;
+        float u = r * two_over_pi;
+        float q_mod_4 = q - 4.0f * std::floor(q * 0.25f);
+        quadrant = q_mod_4 >= 0.0f ? static_cast<int32_t>(q_mod_4) : 0;
+        if (u < 0.0f) {
+            u += 1.0f;
+            --quadrant;
+        }
+        return u;
+    }
+
+    // Quarter-wave symmetry: odd quadrants read the table mirrored, sin is
+    // negative in quadrants 2 and 3, cos in quadrants 1 and 2. With the
+    // default 256 entry table the max abs error is ~5e-6.
+    //
+    // The table clamps NaN to a finite value, so x - x (0, or NaN for NaN
+    // and inf) is added at the end to give NaN like std::sin does.
+    template<unsigned Bits = 8>
+    inline float sin(float x) {
+        int32_t quadrant;
+        float u = reduce_quadrant(x, quadrant);
+        float s = quarter_sine_lut<Bits>::eval(quadrant & 1 ? 1.0f - u : u);
+        return (quadrant & 2 ? -s : s) + (x - x);
+    }
+
+    template<unsigned Bits = 8>
+    inline float cos(float x) {
+        int32_t quadrant;
+        float u = reduce_quadrant(x, quadrant);
+        float c = quarter_sine_lut<Bits>::eval(quadrant & 1 ? u : 1.0f - u);
+        return ((quadrant + 1) & 2 ? -c : c) + (x - x);
+    }
+
+    template<unsigned Bits = 8>
+    inline void sincos(float x, float& s, float& c) {
+        int32_t quadrant;
+        float u = reduce_quadrant(x, quadrant);
+        float a = quarter_sine_lut<Bits>::eval(u);
+        float b = quarter_sine_lut<Bits>::eval(1.0f - u);
+        s = quadrant & 1 ? b : a;
+        c = quadrant & 1 ? a : b;
+        s = (quadrant & 2 ? -s : s) + (x - x);
+        c = ((quadrant + 1) & 2 ? -c : c) + (x - x);
+    }
+
+    FAST_TARGET_AVX2 inline __m256 avx2_reduce_quadrant(__m256 x, __m256i& quadrant) {
+        __m256 q = _mm256_floor_ps(_mm256_mul_ps(x, _mm256_set1_ps(two_over_pi)));
+        __m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_1), x);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_2), r);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_3), r);
+        __m256 u = _mm256_mul_ps(r, _mm256_set1_ps(two_over_pi));
+        __m256 negative = _mm256_cmp_ps(u, _mm256_setzero_ps(), _CMP_LT_OQ);
+        u = _mm256_add_ps(u, _mm256_and_ps(negative, _mm256_set1_ps(1.0f)));
+        // Unlike the scalar cast, vcvtps2dq is defined for NaN, inf and huge
+        // q (it gives 0x80000000), so there is no need to reduce q first
+        quadrant = _mm256_add_epi32(_mm256_cvtps_epi32(q), _mm256_castps_si256(negative));
+        return u;
+    }
+
+    // All ones in lanes with an odd quadrant
+    FAST_TARGET_AVX2 inline __m256 avx2_odd_quadrant(__m256i quadrant) {
+        const __m256i one = _mm256_set1_epi32(1);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+    }
+
+    // Moves bit 1 of the quadrant into the float sign bit
+    FAST_TARGET_AVX2 inline __m256 avx2_quadrant_sign(__m256i quadrant) {
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline __m256 avx2_sin_f32(__m256 x) {
+        __m256i quadrant;
+        __m256 u = avx2_reduce_quadrant(x, quadrant);
+        u = _mm256_blendv_ps(u, _mm256_sub_ps(_mm256_set1_ps(1.0f), u), avx2_odd_quadrant(quadrant));
+        __m256 s = quarter_sine_lut<Bits>::eval_avx2(u);
+        s = _mm256_xor_ps(s, avx2_quadrant_sign(quadrant));
+        return _mm256_add_ps(s, _mm256_sub_ps(x, x));
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline __m256 avx2_cos_f32(__m256 x) {
+        __m256i quadrant;
+        __m256 u = avx2_reduce_quadrant(x, quadrant);
+        u = _mm256_blendv_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), u), u, avx2_odd_quadrant(quadrant));
+        __m256 c = quarter_sine_lut<Bits>::eval_avx2(u);
+        c = _mm256_xor_ps(c, avx2_quadrant_sign(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1))));
+        return _mm256_add_ps(c, _mm256_sub_ps(x, x));
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline void avx2_sincos_f32(__m256 x, __m256& s, __m256& c) {
+        __m256i quadrant;
+        __m256 u = avx2_reduce_quadrant(x, quadrant);
+        __m256 a = quarter_sine_lut<Bits>::eval_avx2(u);
+        __m256 b = quarter_sine_lut<Bits>::eval_avx2(_mm256_sub_ps(_mm256_set1_ps(1.0f), u));
+        __m256 odd = avx2_odd_quadrant(quadrant);
+        __m256 nan = _mm256_sub_ps(x, x);
+        s = _mm256_xor_ps(_mm256_blendv_ps(a, b, odd), avx2_quadrant_sign(quadrant));
+        c = _mm256_xor_ps(_mm256_blendv_ps(b, a, odd),
+            avx2_quadrant_sign(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1))));
+        s = _mm256_add_ps(s, nan);
+        c = _mm256_add_ps(c, nan);
+    }
+
+    template<unsigned Bits = 8>
+    inline void scalar_sin_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::sin<Bits>(x[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    inline void scalar_cos_f32(const std::size_t n, float *y, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            y[i] = fast::cos<Bits>(x[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    inline void scalar_sincos_f32(const std::size_t n, float *s, float *c, const float *x) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fast::sincos<Bits>(x[i], s[i], c[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline void avx2_sin_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_sin_f32<Bits>(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::sin<Bits>(x[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline void avx2_cos_f32(const std::size_t n, float *y, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            _mm256_storeu_ps(y + i, avx2_cos_f32<Bits>(_mm256_loadu_ps(x + i)));
+        }
+        for (; i < n; ++i) {
+            y[i] = fast::cos<Bits>(x[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    FAST_TARGET_AVX2 inline void avx2_sincos_f32(const std::size_t n, float *s, float *c, const float *x) {
+        std::size_t i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m256 vs, vc;
+            avx2_sincos_f32<Bits>(_mm256_loadu_ps(x + i), vs, vc);
+            _mm256_storeu_ps(s + i, vs);
+            _mm256_storeu_ps(c + i, vc);
+        }
+        for (; i < n; ++i) {
+            fast::sincos<Bits>(x[i], s[i], c[i]);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    inline void sin(const std::size_t n, float *y, const float *x) {
+        if (kernels().level >= isa::avx2) {
+            avx2_sin_f32<Bits>(n, y, x);
+        } else {
+            scalar_sin_f32<Bits>(n, y, x);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    inline void cos(const std::size_t n, float *y, const float *x) {
+        if (kernels().level >= isa::avx2) {
+            avx2_cos_f32<Bits>(n, y, x);
+        } else {
+            scalar_cos_f32<Bits>(n, y, x);
+        }
+    }
+
+    template<unsigned Bits = 8>
+    inline void sincos(const std::size_t n, float *s, float *c, const float *x) {
+        if (kernels().level >= isa::avx2) {
+            avx2_sincos_f32<Bits>(n, s, c, x);
+        } else {
+            scalar_sincos_f32<Bits>(n, s, c, x);
+        }
+    }
+}
@@ -3,8 +3,12 @@
 #include <iomanip>
 #include <cstdint>
 #include <bit>
+#include <optional>
+#include <vector>
 
 #include "graphs.hpp"
+#include "fast_gaussian.hpp"
+#include "reference_table.hpp"
 
 union FloatInt {
     float f;
@@ -158,6 +162,15 @@ void test_square() {
     }
 }
 
+// gaussian.ref from reference_tables when main() was given a directory
+// holding one, the batch and integer sweeps then read their references from it
+std::optional<fast::reference_table> gaussian_table;
+
+float reference_gaussian(float t) {
+    return gaussian_table && gaussian_table->covers(t)
+        ? static_cast<float>((*gaussian_table)(t)) : std::exp(-t * t / 2.0f);
+}
+
 void test_gaussian() {
     int n_tests = 10;
 
@@ -178,9 +191,118 @@ void test_gaussian() {
     }
 }
 
+template<bool Refined>
+float max_batch_error(const std::vector<float>& x, float mu, float sigma, fast::isa level) {
+    std::vector<float> y(x.size());
+    switch (level) {
+    case fast::isa::avx512:
+        fast::avx512_gaussian_f32<Refined>(x.size(), y.data(), x.data(), mu, sigma);
+        break;
+    case fast::isa::avx2:
+        fast::avx2_gaussian_f32<Refined>(x.size(), y.data(), x.data(), mu, sigma);
+        break;
+    default:
+        fast::scalar_gaussian_f32<Refined>(x.size(), y.data(), x.data(), mu, sigma);
+        break;
+    }
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < x.size(); i++) {
+        float t = (x[i] - mu) / sigma;
+        max_error = std::max(max_error, std::fabs(reference_gaussian(t) - y[i]));
+    }
+    return max_error;
+}
+
+void test_gaussian_batch() {
+    const float mu = 1.5f;
+    const float sigma = 0.7f;
+    // Odd length so the vector kernels run their tails too
+    std::vector<float> x;
+    for (float v = mu - 10 * sigma; v <= mu + 10 * sigma; v += 0.0001f) {
+        x.push_back(v);
+    }
+
+    for (auto level : {fast::isa::scalar, fast::isa::avx2, fast::isa::avx512}) {
+        if (!fast::isa_supported(level)) {
+            continue;
+        }
+        std::cout << std::setprecision(6) << fast::isa_name(level)
+            << " gaussian max abs error: " << max_batch_error<false>(x, mu, sigma, level)
+            << ", refined: " << max_batch_error<true>(x, mu, sigma, level) << std::endl;
+    }
+}
+
+void gaussian_int_kernel(fast::isa level, size_t n, float *y, const float *t) {
+    switch (level) {
+    case fast::isa::avx512:
+        fast::avx512_gaussian_int_f32(n, y, t);
+        break;
+    case fast::isa::avx2:
+        fast::avx2_gaussian_int_f32(n, y, t);
+        break;
+    default:
+        fast::scalar_gaussian_int_f32(n, y, t);
+        break;
+    }
+}
+
+// Every float from 2^-13 to 16, below that q is always 0 and the result
+// is constant. Checks each vector kernel the host supports bit for bit
+// against the scalar one, not just the one gaussian_int() dispatches to.
+void test_gaussian_int() {
+    const uint32_t first = 0x39000000; // 2^-13
+    const uint32_t last = 0x41800000;  // 16.0f
+    const size_t chunk = 1 << 16;
+    const fast::isa levels[] = {fast::isa::avx2, fast::isa::avx512};
+
+    std::vector<float> t(chunk), y(chunk), y_scalar(chunk);
+    float max_abs_error = 0.0f;
+    float max_rel_error = 0.0f;
+    size_t mismatches[std::size(levels)] = {};
+    for (uint32_t base = first; base < last; base += chunk) {
+        for (size_t k = 0; k < chunk; k++) {
+            t[k] = std::bit_cast<float>(base + static_cast<uint32_t>(k));
+        }
+        fast::scalar_gaussian_int_f32(chunk, y_scalar.data(), t.data());
+
+        for (size_t k = 0; k < chunk; k++) {
+            float true_value = reference_gaussian(t[k]);
+            float error = std::fabs(true_value - y_scalar[k]);
+            max_abs_error = std::max(max_abs_error, error);
+            if (t[k] <= 3.0f) {
+                max_rel_error = std::max(max_rel_error, error / true_value);
+            }
+        }
+
+        for (size_t l = 0; l < std::size(levels); l++) {
+            if (!fast::isa_supported(levels[l])) {
+                continue;
+            }
+            gaussian_int_kernel(levels[l], chunk, y.data(), t.data());
+            for (size_t k = 0; k < chunk; k++) {
+                mismatches[l] += std::bit_cast<uint32_t>(y[k]) != std::bit_cast<uint32_t>(y_scalar[k]);
+            }
+        }
+    }
+
+    std::cout << std::setprecision(6)
+        << "gaussian_int max abs error: " << max_abs_error
+        << ", max rel error (|t| <= 3): " << max_rel_error << std::endl;
+    for (size_t l = 0; l < std::size(levels); l++) {
+        if (fast::isa_supported(levels[l])) {
+            std::cout << "  " << fast::isa_name(levels[l]) << "/scalar mismatches: " << mismatches[l] << std::endl;
+        }
+    }
+}
 
-int main()
+// Optionally pass a directory of reference_tables output to take the
+// references from gaussian.ref
+int main(int argc, char **argv)
 {
+	if (argc > 1) {
+		gaussian_table = fast::open_reference_table(argv[1], "gaussian");
+	}
 
 
 	size_t height = 160;
@@ -199,6 +321,8 @@ int main()
 	graphs::functions(height, width, xmin, xmax, ymin, ymax, 2, functions);
 
     test_gaussian();
+    test_gaussian_batch();
+    test_gaussian_int();
 
     //test_square();
 	return 0;
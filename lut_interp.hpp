@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "constexpr_math.hpp"
+#include "fast_math.hpp"
+
+namespace fast {
+
+    // Closed interval a table covers, inputs outside it are clamped
+    template<double Lo, double Hi>
+    struct domain {
+        static_assert(Lo < Hi);
+        static constexpr double lo = Lo;
+        static constexpr double hi = Hi;
+    };
+
+    // Piecewise-linear approximation of Func over Domain with 2^Bits
+    // segments, the same table + slope + lerp pattern as
+    // log_lookup_table.py, sin_lookup_table.py and tanh_lookup_table.py.
+    // Func is any type whose call operator is constexpr (a lambda works),
+    // the tables are built at compile time.
+    //
+    //     using sin_lut = fast::lut_interp<decltype([](double x) {
+    //         return fast::cmath::sin(x * fast::cmath::pi / 2);
+    //     }), 4, fast::domain<0.0, 1.0>>;
+    //
+    // Up to 8 segments the AVX2 lookup is an in-register vpermps, larger
+    // tables use vgatherdps.
+    template<typename Func, unsigned Bits, typename Domain>
+    struct lut_interp {
+        static_assert(Bits <= 16, "table would not fit in cache");
+
+        static constexpr std::size_t size = std::size_t(1) << Bits;
+        static constexpr float lo = static_cast<float>(Domain::lo);
+        static constexpr float hi = static_cast<float>(Domain::hi);
+        static constexpr float scale = static_cast<float>(size / (Domain::hi - Domain::lo));
+
+        // Padded to a full ymm so small tables can be loaded for vpermps
+        static constexpr std::size_t storage = size < 8 ? 8 : size;
+
+        struct tables {
+            alignas(32) std::array<float, storage> values;
+            alignas(32) std::array<float, storage> slopes;
+        };
+
+        static constexpr tables build() {
+            tables t{};
+            const double step = (Domain::hi - Domain::lo) / size;
+            double y0 = Func{}(Domain::lo);
+            for (std::size_t i = 0; i < size; ++i) {
+                double y1 = Func{}(Domain::lo + (i + 1) * step);
+                t.values[i] = static_cast<float>(y0);
+                t.slopes[i] = static_cast<float>(y1 - y0);
+                y0 = y1;
+            }
+            return t;
+        }
+
+        static constexpr tables table = build();
+
+        static float eval(float x) {
+            // lo first so NaN clamps to lo, as _mm256_max_ps does below
+            x = std::min(std::max(lo, x), hi);
+            float scaled_x = (x - lo) * scale;
+            std::size_t index = std::min(static_cast<std::size_t>(scaled_x), size - 1);
+            float fraction = scaled_x - static_cast<float>(index);
+            return table.values[index] + fraction * table.slopes[index];
+        }
+
+        FAST_TARGET_AVX2 static __m256 eval_avx2(__m256 x) {
+            x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(lo)), _mm256_set1_ps(hi));
+            __m256 scaled_x = _mm256_mul_ps(_mm256_sub_ps(x, _mm256_set1_ps(lo)), _mm256_set1_ps(scale));
+            __m256i index = _mm256_min_epi32(_mm256_cvttps_epi32(scaled_x), _mm256_set1_epi32(size - 1));
+            __m256 fraction = _mm256_sub_ps(scaled_x, _mm256_cvtepi32_ps(index));
+
+            __m256 values, slopes;
+            if constexpr (size <= 8) {
+                values = _mm256_permutevar8x32_ps(_mm256_load_ps(table.values.data()), index);
+                slopes = _mm256_permutevar8x32_ps(_mm256_load_ps(table.slopes.data()), index);
+            } else {
+                values = _mm256_i32gather_ps(table.values.data(), index, 4);
+                slopes = _mm256_i32gather_ps(table.slopes.data(), index, 4);
+            }
+            return _mm256_fmadd_ps(fraction, slopes, values);
+        }
+
+        static void eval(const std::size_t n, float *y, const float *x) {
+            for (std::size_t i = 0; i < n; ++i) {
+                y[i] = eval(x[i]);
+            }
+        }
+
+        FAST_TARGET_AVX2 static void eval_avx2(const std::size_t n, float *y, const float *x) {
+            std::size_t i = 0;
+            for (; i + 7 < n; i += 8) {
+                _mm256_storeu_ps(y + i, eval_avx2(_mm256_loadu_ps(x + i)));
+            }
+            for (; i < n; ++i) {
+                y[i] = eval(x[i]);
+            }
+        }
+    };
+}
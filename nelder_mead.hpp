@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "accuracy_sweep.hpp"
+#include "thread_pool.hpp"
+
+namespace fast {
+
+    // How an approximation's error over a grid is folded into one number
+    enum class error_norm { mean_rel, max_rel, max_ulp };
+
+    inline const char *error_norm_name(error_norm norm) {
+        switch (norm) {
+        case error_norm::mean_rel: return "mean rel";
+        case error_norm::max_rel: return "max rel";
+        case error_norm::max_ulp: return "max ulp";
+        }
+        return "unknown";
+    }
+
+    // Error of approx(x[i]) against precomputed reference[i]. Non-finite
+    // results make the error infinite, so an optimizer steps away from them.
+    template<typename Approx>
+    double approximation_error(error_norm norm, const std::vector<float>& x, const std::vector<double>& reference,
+                               Approx approx) {
+        double total = 0.0;
+        double worst = 0.0;
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            float approx_value = approx(x[i]);
+            if (!std::isfinite(approx_value)) {
+                return std::numeric_limits<double>::infinity();
+            }
+            double error = std::fabs(static_cast<double>(approx_value) - reference[i]);
+            error /= norm == error_norm::max_ulp ? float_ulp(reference[i]) : std::fabs(reference[i]);
+            total += error;
+            worst = std::max(worst, error);
+        }
+        return norm == error_norm::mean_rel ? total / static_cast<double>(x.size()) : worst;
+    }
+
+    template<std::size_t N>
+    struct nelder_mead_result {
+        std::array<double, N> x;
+        double value;
+        std::size_t iterations;
+        std::size_t evaluations;
+    };
+
+    struct nelder_mead_options {
+        // Stop once the simplex values agree to this relative spread
+        double tolerance = 1e-9;
+        std::size_t max_iterations = 5000;
+    };
+
+    // Minimizes objective(std::array<double, N>) from a start point and a
+    // per-parameter initial step. Each iteration speculatively evaluates
+    // the reflection, expansion and both contractions at once on the pool,
+    // then takes whichever one the standard Nelder-Mead rules pick, so an
+    // iteration costs one round of evaluations instead of up to three.
+    // Shrinks evaluate the N moved vertices in parallel too. The objective
+    // runs on pool threads and must not use the same pool itself. NaN
+    // values count as +inf.
+    template<std::size_t N, typename Objective>
+    nelder_mead_result<N> nelder_mead(Objective objective, const std::array<double, N>& start,
+                                      const std::array<double, N>& step, nelder_mead_options options = {},
+                                      thread_pool& pool = thread_pool::global()) {
+        using point = std::array<double, N>;
+        std::size_t evaluations = 0;
+        const auto evaluate = [&](const std::vector<point>& points, std::vector<double>& values) {
+            values.resize(points.size());
+            pool.parallel_for(points.size(), [&](std::size_t i) {
+                double value = objective(points[i]);
+                values[i] = std::isnan(value) ? std::numeric_limits<double>::infinity() : value;
+            });
+            evaluations += points.size();
+        };
+
+        std::vector<point> simplex(N + 1, start);
+        for (std::size_t i = 0; i < N; ++i) {
+            simplex[i + 1][i] += step[i];
+        }
+        std::vector<double> values;
+        evaluate(simplex, values);
+
+        std::vector<std::size_t> order(N + 1);
+        std::vector<point> trial(4);
+        std::vector<double> trial_values;
+        std::size_t iteration = 0;
+        for (; iteration < options.max_iterations; ++iteration) {
+            std::iota(order.begin(), order.end(), std::size_t(0));
+            std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return values[a] < values[b]; });
+            const std::size_t best = order[0];
+            const std::size_t second_worst = order[N - 1];
+            const std::size_t worst = order[N];
+
+            const double spread = values[worst] - values[best];
+            if (spread <= options.tolerance * std::fabs(values[best])) {
+                break;
+            }
+
+            point centroid{};
+            for (std::size_t v = 0; v < N; ++v) {
+                for (std::size_t i = 0; i < N; ++i) {
+                    centroid[i] += simplex[order[v]][i] / N;
+                }
+            }
+            // Reflection, expansion, outside and inside contraction
+            const double coefficients[4] = {1.0, 2.0, 0.5, -0.5};
+            for (std::size_t t = 0; t < 4; ++t) {
+                for (std::size_t i = 0; i < N; ++i) {
+                    trial[t][i] = centroid[i] + coefficients[t] * (centroid[i] - simplex[worst][i]);
+                }
+            }
+            evaluate(trial, trial_values);
+
+            const double reflected = trial_values[0];
+            std::size_t accept = 4;
+            if (reflected < values[best]) {
+                accept = trial_values[1] < reflected ? 1 : 0;
+            } else if (reflected < values[second_worst]) {
+                accept = 0;
+            } else if (reflected < values[worst]) {
+                accept = trial_values[2] <= reflected ? 2 : 4;
+            } else {
+                accept = trial_values[3] < values[worst] ? 3 : 4;
+            }
+
+            if (accept < 4) {
+                simplex[worst] = trial[accept];
+                values[worst] = trial_values[accept];
+                continue;
+            }
+
+            // Shrink everything towards the best vertex
+            std::vector<point> moved;
+            for (std::size_t v = 1; v <= N; ++v) {
+                point p = simplex[order[v]];
+                for (std::size_t i = 0; i < N; ++i) {
+                    p[i] = simplex[best][i] + 0.5 * (p[i] - simplex[best][i]);
+                }
+                moved.push_back(p);
+            }
+            std::vector<double> moved_values;
+            evaluate(moved, moved_values);
+            for (std::size_t v = 1; v <= N; ++v) {
+                simplex[order[v]] = moved[v - 1];
+                values[order[v]] = moved_values[v - 1];
+            }
+        }
+
+        const std::size_t best = std::min_element(values.begin(), values.end()) - values.begin();
+        return {simplex[best], values[best], iteration, evaluations};
+    }
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
 #include <vector>
@@ -6,15 +8,23 @@
 #include <iomanip>
 #include <iostream>
 #include <cstdint>
+#include <optional>
 
-#include <cassert>
+#include <immintrin.h>
+
+#include "fast_math.hpp"
+#include "nelder_mead.hpp"
+#include "reference_table.hpp"
 
 float reference_impl(float x) {
     return expf(x);
 }
 
+// Bits below zero clamp to +0.0f, the uint32 cast of a negative float is
+// undefined and used to turn every bias that went negative anywhere on the
+// grid into NaN
 float test_impl(float x, float scalar, float bias) {
-    return std::bit_cast<float>((uint32_t)(std::fma(scalar, x , bias)));
+    return std::bit_cast<float>((uint32_t)(std::max(std::fma(scalar, x , bias), 0.0f)));
 }
 
 float rel_error(float scalar, float bias, float x) {
@@ -34,40 +44,172 @@ float average_rel_error(float scalar, float bias) {
     return total / ctr;
 }
 
-// Grid search followed by local optimization
-float optimize_magic(float initial_magic, float end) {
-    // First do a grid search around the initial value
-    float best_magic = initial_magic;
-    const float scalar = 12102203.2f;
-    float best_error = 1.0; // average_rel_error(scalar, initial_magic);
+// The grid average_rel_error walks, with expf evaluated once up front.
+// Padded to a multiple of 16 with reference = inv_reference = 0, which
+// adds nothing to the error sum as long as the approximation is finite.
+struct error_grid {
+    std::vector<float> x;
+    std::vector<float> reference;
+    std::vector<float> inv_reference;
+    std::size_t count = 0;
+};
+
+// Takes the references from an exp_grid table written by reference_tables
+// when one is given and was built over the same inputs, expf otherwise
+error_grid make_error_grid(const fast::reference_table *table = nullptr) {
+    error_grid grid;
+    for(float x = -88.0f; x <= 88.0f; x += 0.1f) {
+        grid.x.push_back(x);
+    }
+    const bool use_table = table && table->inputs().size() == grid.x.size()
+        && std::equal(grid.x.begin(), grid.x.end(), table->inputs().begin());
+    for (std::size_t i = 0; i < grid.x.size(); ++i) {
+        float true_value = use_table ? static_cast<float>(table->values()[i]) : reference_impl(grid.x[i]);
+        grid.reference.push_back(true_value);
+        grid.inv_reference.push_back(1.0f / true_value);
+    }
+    grid.count = grid.x.size();
+    while (grid.x.size() % 16 != 0) {
+        grid.x.push_back(0.0f);
+        grid.reference.push_back(0.0f);
+        grid.inv_reference.push_back(0.0f);
+    }
+    return grid;
+}
+
+// Same error as average_rel_error, but from the precomputed grid. The
+// int32 conversion matches test_impl's uint32 cast as long as the fma stays
+// below 2^31, which magic_bounds guarantees.
+float scalar_grid_rel_error(const error_grid& grid, float scalar, float bias) {
+    float total = 0.0f;
+    for (std::size_t i = 0; i < grid.x.size(); ++i) {
+        float approx_value = std::bit_cast<float>(static_cast<int32_t>(std::max(std::fma(scalar, grid.x[i], bias), 0.0f)));
+        total += fabsf(grid.reference[i] - approx_value) * grid.inv_reference[i];
+    }
+    return total / grid.count;
+}
+
+FAST_TARGET_AVX2 float avx2_grid_rel_error(const error_grid& grid, float scalar, float bias) {
+    const __m256 vscalar = _mm256_set1_ps(scalar);
+    const __m256 vbias = _mm256_set1_ps(bias);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 total = _mm256_setzero_ps();
+    for (std::size_t i = 0; i < grid.x.size(); i += 8) {
+        __m256 x = _mm256_loadu_ps(grid.x.data() + i);
+        __m256 approx_value = _mm256_castsi256_ps(_mm256_cvttps_epi32(
+            _mm256_max_ps(_mm256_fmadd_ps(vscalar, x, vbias), _mm256_setzero_ps())));
+        __m256 error = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(grid.reference.data() + i), approx_value), abs_mask);
+        total = _mm256_fmadd_ps(error, _mm256_loadu_ps(grid.inv_reference.data() + i), total);
+    }
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(total), _mm256_extractf128_ps(total, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum) / grid.count;
+}
 
-    std::size_t ctr = 0;
-    std::size_t print_ctr = 1.00;
-    for (float test_constant = initial_magic; test_constant <= end; test_constant = std::nextafterf(test_constant, INFINITY)) {
+FAST_TARGET_AVX512 float avx512_grid_rel_error(const error_grid& grid, float scalar, float bias) {
+    const __m512 vscalar = _mm512_set1_ps(scalar);
+    const __m512 vbias = _mm512_set1_ps(bias);
+    __m512 total = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < grid.x.size(); i += 16) {
+        __m512 x = _mm512_loadu_ps(grid.x.data() + i);
+        __m512 approx_value = _mm512_castsi512_ps(_mm512_cvttps_epi32(
+            _mm512_max_ps(_mm512_fmadd_ps(vscalar, x, vbias), _mm512_setzero_ps())));
+        __m512 error = _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(grid.reference.data() + i), approx_value));
+        total = _mm512_fmadd_ps(error, _mm512_loadu_ps(grid.inv_reference.data() + i), total);
+    }
+    return _mm512_reduce_add_ps(total) / grid.count;
+}
+
+float grid_rel_error(const error_grid& grid, float scalar, float bias) {
+    switch (fast::kernels().level) {
+    case fast::isa::avx512:
+        return avx512_grid_rel_error(grid, scalar, bias);
+    case fast::isa::avx2:
+        return avx2_grid_rel_error(grid, scalar, bias);
+    default:
+        return scalar_grid_rel_error(grid, scalar, bias);
+    }
+}
 
-        float error = average_rel_error(scalar, test_constant);
-        if (!std::isnan(error) && error < best_error) {
-            printf("Grid search: magic=%f error=%e\n", test_constant, error);
-            best_error = error;
-            best_magic = test_constant;
+// Non-negative biases for which scalar * x + bias stays below 2^31 over
+// the whole grid. Past that the results are NaN bits or worse, so the old
+// scan up to FLT_MAX was only ever testing garbage beyond hi.
+void magic_bounds(const error_grid& grid, float scalar, float& lo, float& hi) {
+    float x_max = grid.x[grid.count - 1];
+    lo = 0.0f;
+    hi = std::nextafterf(2147483648.0f - scalar * x_max, 0.0f);
+}
+
+// Index of the candidate with the lowest error, candidates are split
+// across the thread pool. NaN errors never win, like in the old scan.
+std::size_t best_candidate(const error_grid& grid, float scalar, const std::vector<float>& candidates, float& best_error) {
+    std::vector<float> errors(candidates.size());
+    const std::size_t block = 256;
+    fast::thread_pool::global().parallel_for((candidates.size() + block - 1) / block, [&](std::size_t task) {
+        std::size_t end = std::min(candidates.size(), (task + 1) * block);
+        for (std::size_t i = task * block; i < end; ++i) {
+            errors[i] = grid_rel_error(grid, scalar, candidates[i]);
         }
-        ctr++;
-        //std::cout << std::setprecision(30) << "testing magic: " << std::dec << test_constant << std::endl;
-        if(ctr / print_ctr >= 10.0) {
-            print_ctr = ctr;
-            std::cout << std::setprecision(15) 
-                      << "ctr: " << std::dec << ctr 
-                      << " Best so far: " << best_magic 
-                      << " error: " << best_error 
-                      << " constant: " << test_constant << "\n";
+    });
+
+    std::size_t best = 0;
+    best_error = std::numeric_limits<float>::infinity();
+    for (std::size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i] < best_error) {
+            best_error = errors[i];
+            best = i;
         }
     }
+    return best;
+}
+
+// Coarse-to-fine search over [lo, hi]: every level evaluates evenly spaced
+// candidates and narrows to two spacings either side of the best one. Once
+// the spacing is down to a float ulp, every float left in the window is
+// tried. Assumes the error has a single basin at the coarse resolution,
+// which holds for the bias of the Schraudolph exp.
+float optimize_magic(const error_grid& grid, float scalar, float lo, float hi) {
+    const std::size_t level_candidates = 4096;
+    float best_magic = lo;
+    float best_error = std::numeric_limits<float>::infinity();
+    std::vector<float> candidates;
 
-    printf("Search result: magic=%f error=%e\n", best_magic, best_error);
+    for (int level = 0;; ++level) {
+        double step = (double(hi) - lo) / (level_candidates - 1);
+        float ulp = std::nextafterf(hi, INFINITY) - hi;
+        if (step <= ulp) {
+            break;
+        }
+
+        candidates.clear();
+        for (std::size_t i = 0; i < level_candidates; ++i) {
+            candidates.push_back(static_cast<float>(lo + step * i));
+        }
+        best_magic = candidates[best_candidate(grid, scalar, candidates, best_error)];
+        printf("Level %d: step=%e magic=%f error=%e\n", level, step, best_magic, best_error);
+
+        lo = std::max(lo, static_cast<float>(best_magic - 2 * step));
+        hi = std::min(hi, static_cast<float>(best_magic + 2 * step));
+    }
+
+    candidates.clear();
+    for (float test_constant = lo; test_constant <= hi; test_constant = std::nextafterf(test_constant, INFINITY)) {
+        candidates.push_back(test_constant);
+    }
+    float final_error;
+    float final_magic = candidates[best_candidate(grid, scalar, candidates, final_error)];
+    if (final_error < best_error) {
+        best_magic = final_magic;
+        best_error = final_error;
+    }
+
+    printf("Search result: magic=%f error=%e (%zu floats in the final window)\n", best_magic, best_error, candidates.size());
     return best_magic;
 }
 
-int main() {
+// Optionally pass the exp_grid.ref from reference_tables
+int main(int argc, char **argv) {
     // 12102203.161561485f -> optimal?
     // 1064872507.1541044f
     // float magic = 12102203.2f; // approx. (2^23) * log2(e)
@@ -75,20 +217,35 @@ int main() {
 
     const float test1 = 1064872507.1541044f;
     const float test2 = 1064872507.0f;
-    assert(test1 != test2);
     std::cout << std::setprecision(15) << "test1: " << test1 << " test2: " << test2 << std::endl;
     std::cout << std::setprecision(15) << "test1: " << std::nextafterf(test1, INFINITY) << " test2: " << std::nextafterf(test2, INFINITY) << std::endl;
     
+    const float scalar = 12102203.2f;
     float initial_magic = 0x3f700000;
-    float optimized_magic = optimize_magic(initial_magic, std::numeric_limits<float>::max());
-
+    std::optional<fast::reference_table> table;
+    if (argc > 1) {
+        table.emplace(argv[1], "exp");
+    }
+    error_grid grid = make_error_grid(table ? &*table : nullptr);
+    float lo, hi;
+    magic_bounds(grid, scalar, lo, hi);
+    printf("Searching magic in [%f, %f] with %s kernels\n", lo, hi, fast::isa_name(fast::kernels().level));
+    float optimized_magic = optimize_magic(grid, scalar, lo, hi);
 
-    const float scalar = 12102203.2f;
     printf("Original magic: %f\n", initial_magic);
     printf("Optimized magic: %f\n", optimized_magic);
     printf("Original average error: %e\n", average_rel_error(scalar, initial_magic));
     printf("Optimized average error: %e\n", average_rel_error(scalar, optimized_magic));
 
+    // The bias search holds scalar fixed, let both move together from there
+    auto joint = fast::nelder_mead(
+        [&](const std::array<double, 2>& p) {
+            return grid_rel_error(grid, static_cast<float>(p[0]), static_cast<float>(p[1]));
+        },
+        std::array<double, 2>{scalar, optimized_magic}, std::array<double, 2>{1000.0, 1 << 16});
+    printf("Joint scalar=%f magic=%f error=%e (%zu evaluations)\n",
+           joint.x[0], joint.x[1], joint.value, joint.evaluations);
+
     float test_points[] = {0.0f, 0.5f, 1.0f, 2.0f};
     for (float x : test_points) {
         float true_val = reference_impl(x);
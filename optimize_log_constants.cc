@@ -1,10 +1,15 @@
+#include <array>
 #include <bit>
 #include <cstdint>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 #include <cmath>
 
+#include "nelder_mead.hpp"
+
 union lens { float float_view; unsigned long int_view; };
 union blens { unsigned long int_view; float float_view; };
 
@@ -29,97 +34,54 @@ float func(float x, float curvature = 50000.0f) {
     return std::bit_cast<float>((uint32_t)(-0x3f800000 - curvature*x)) + 1.5*2.718281828f;
 }
 
-struct FuncWrapper {
-    float curvature;
-    static float func_with_curvature(float x, float c) {
-        return std::bit_cast<float>((uint32_t)(-0x3f800000 - c*x)) + 1.5*2.718281828f;;
-    }
-
-    float operator()(float x) const {
-        return func_with_curvature(x, curvature);
-    }
-};
-
-/* -------------------------- */
-
-template<typename F>
-float second_derivative(F f, float x, float h = 0.0001f) {
-    float fx_plus_h = f(x + h);
-    float fx = f(x);
-    float fx_minus_h = f(x - h);
-    return (fx_plus_h - 2*fx + fx_minus_h) / (h*h);
-}
+// func with every constant free: scale * bits(bias - curvature * x) + shift.
+// bias is in float bit units, -0x3f800000 wraps around to 0xc0800000
+// (-4.0f). The wrap goes through int64, casting a negative float straight
+// to uint32 is undefined.
+using log_params = std::array<double, 4>; // scale, bias, curvature, shift
 
-// Helper function to calculate approximate first derivative
-template<typename F>
-float first_derivative(F f, float x, float h = 0.0001f) {
-    return (f(x + h) - f(x - h)) / (2*h);
+float log_model(float x, const log_params& p) {
+    int64_t bits = static_cast<int64_t>(p[1] - p[2] * x);
+    return static_cast<float>(p[0] * std::bit_cast<float>(static_cast<uint32_t>(bits)) + p[3]);
 }
 
-// Calculate approximate curvature using κ = |f''| / (1 + f'^2)^(3/2)
-template<typename F>
-float calculate_curvature(F f, float x) {
-    float first_deriv = first_derivative(f, x);
-    float second_deriv = second_derivative(f, x);
-
-    return std::abs(second_deriv) / std::pow(1 + first_deriv*first_deriv, 1.5f);
-}
-
-// Function to calculate average curvature difference over the range
-float curvature_difference(float curvature_param, float x_min, float x_max, int num_points) {
-    FuncWrapper func_wrap{curvature_param};
-    auto f = [func_wrap](auto x){func_wrap(x);};
-
-    float total_diff = 0.0f;
-    float step = (x_max - x_min) / (num_points - 1);
-
-    for (int i = 0; i < num_points; ++i) {
-        float x = x_min + i * step;
-        float fun_curvature = calculate_curvature(func_wrap, x);
-        float flog_curvature = calculate_curvature(flog, x);
-        total_diff += std::abs(fun_curvature - flog_curvature);
+void print_errors(const char *label, const log_params& p,
+                  const std::vector<float>& xs, const std::vector<double>& reference) {
+    printf("%s: scale=%.9g bias=0x%08x curvature=%.9g shift=%.9g\n", label, p[0],
+           static_cast<uint32_t>(static_cast<int64_t>(p[1])), p[2], p[3]);
+    for (fast::error_norm norm : {fast::error_norm::mean_rel, fast::error_norm::max_rel, fast::error_norm::max_ulp}) {
+        double error = fast::approximation_error(norm, xs, reference, [&](float x) { return log_model(x, p); });
+        printf("  %-9s %e\n", fast::error_norm_name(norm), error);
     }
-
-    return total_diff / num_points;
 }
 
-float optimize_curvature(float min_curvature, float max_curvature,
-                        float tolerance = 1e-5f, int max_iterations = 100) {
-    const float golden_ratio = (1.0f + std::sqrt(5.0f)) / 2.0f;
-    const float x_min = 1.0f;
+int main() {
+    // ln over the range optimize_curvature used to compare curvature on,
+    // starting at 2 since ln(1) = 0 has no relative error
+    const float x_min = 2.0f;
     const float x_max = 1000.0f;
-    const int num_points = 10;  // Number of points to sample for curvature comparison
-
-    float a = min_curvature;
-    float b = max_curvature;
-    float c = b - (b - a) / golden_ratio;
-    float d = a + (b - a) / golden_ratio;
-
-    for (int i = 0; i < max_iterations; ++i) {
-        float fc = curvature_difference(c, x_min, x_max, num_points);
-        float fd = curvature_difference(d, x_min, x_max, num_points);
-
-        if (fc < fd) {
-            b = d;
-            d = c;
-            c = b - (b - a) / golden_ratio;
-        } else {
-            a = c;
-            c = d;
-            d = a + (b - a) / golden_ratio;
-        }
-
-        if (std::abs(b - a) < tolerance) {
-            return (a + b) / 2.0f;
-        }
+    const int num_points = 4096;
+    std::vector<float> xs;
+    std::vector<double> reference;
+    for (int i = 0; i < num_points; ++i) {
+        float x = x_min + (x_max - x_min) * i / (num_points - 1);
+        xs.push_back(x);
+        reference.push_back(std::log(static_cast<double>(x)));
     }
 
-    return (a + b) / 2.0f;
-}
-
-int main() {
-    // Example usage
-    float optimal_curvature = optimize_curvature(1000.0f, 100000.0f);
-    printf("Optimal curvature parameter: %f\n", optimal_curvature);
+    const log_params start = {1.0, static_cast<double>(static_cast<uint32_t>(-0x3f800000)), 50000.0, 1.5 * 2.718281828};
+    const log_params step = {0.1, 1 << 20, 5000.0, 0.5};
+    print_errors("func", start, xs, reference);
+
+    for (fast::error_norm norm : {fast::error_norm::mean_rel, fast::error_norm::max_rel, fast::error_norm::max_ulp}) {
+        auto result = fast::nelder_mead(
+            [&](const log_params& p) {
+                return fast::approximation_error(norm, xs, reference, [&](float x) { return log_model(x, p); });
+            },
+            start, step);
+        printf("Optimized for %s in %zu iterations, %zu evaluations\n",
+               fast::error_norm_name(norm), result.iterations, result.evaluations);
+        print_errors("  result", result.x, xs, reference);
+    }
     return 0;
-}
\ No newline at end of file
+}
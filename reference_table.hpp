@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "thread_pool.hpp"
+
+namespace fast {
+
+    // Precomputed double references in a flat binary file, so optimizers
+    // and sweeps can mmap them instead of calling expf/logf/std::exp again.
+    // Read-only shared mappings also share the page cache between processes.
+    //
+    // Layout: a 64 byte reference_header, then for range tables `count`
+    // doubles, one per float from first_key on in reference_key order.
+    // Grid tables hold `count` float inputs, padded to 8 bytes, then
+    // `count` doubles. A range table costs 8 bytes per float, ~17 GB for
+    // the 2^31 floats in [-88, 88].
+    enum class reference_kind : uint32_t { range = 1, grid = 2 };
+
+    // Orders floats by value as unsigned integers, so any float interval is
+    // one contiguous run of keys. -0.0 sorts just below 0.0.
+    constexpr uint32_t reference_key(float x) {
+        uint32_t bits = std::bit_cast<uint32_t>(x);
+        return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+    }
+
+    constexpr float reference_input(uint32_t key) {
+        return std::bit_cast<float>(key & 0x80000000u ? key & 0x7FFFFFFFu : ~key);
+    }
+
+    struct reference_header {
+        char magic[8];
+        uint32_t version;
+        reference_kind kind;
+        char function[32];
+        uint64_t count;
+        uint32_t first_key;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(reference_header) == 64);
+
+    constexpr char reference_magic[8] = {'F', 'A', 'S', 'T', 'R', 'E', 'F', '\0'};
+    constexpr uint32_t reference_version = 1;
+
+    namespace reference_detail {
+        inline std::size_t inputs_bytes(const reference_header& header) {
+            if (header.kind != reference_kind::grid) {
+                return 0;
+            }
+            return (header.count * sizeof(float) + 7) & ~std::size_t(7);
+        }
+
+        inline std::size_t file_bytes(const reference_header& header) {
+            return sizeof(reference_header) + inputs_bytes(header) + header.count * sizeof(double);
+        }
+
+        inline std::runtime_error error(const std::string& what, const char *path) {
+            return std::runtime_error(what + ": " + path);
+        }
+
+        // Sizes the file, maps it writable and lets fill() write the payload
+        template<typename Fill>
+        void write(const char *path, const reference_header& header, Fill fill) {
+            const std::size_t bytes = file_bytes(header);
+            int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throw error("cannot create reference table", path);
+            }
+            if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+                ::close(fd);
+                throw error("cannot size reference table", path);
+            }
+            void *map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (map == MAP_FAILED) {
+                throw error("cannot map reference table", path);
+            }
+
+            char *base = static_cast<char *>(map);
+            std::memcpy(base, &header, sizeof(header));
+            fill(base + sizeof(header));
+            ::msync(map, bytes, MS_SYNC);
+            ::munmap(map, bytes);
+        }
+    }
+
+    // Writes reference(x) for every float in [lo, hi], filled in parallel
+    // straight into the mapped file
+    template<typename Reference>
+    void write_reference_range(const char *path, const char *function, Reference reference,
+                              float lo, float hi, thread_pool& pool = thread_pool::global()) {
+        const uint32_t first = reference_key(lo);
+        const uint32_t last = reference_key(hi);
+        reference_header header{};
+        std::memcpy(header.magic, reference_magic, sizeof(header.magic));
+        header.version = reference_version;
+        header.kind = reference_kind::range;
+        std::strncpy(header.function, function, sizeof(header.function) - 1);
+        header.count = uint64_t(last) - first + 1;
+        header.first_key = first;
+
+        reference_detail::write(path, header, [&](char *payload) {
+            double *values = reinterpret_cast<double *>(payload);
+            const uint64_t chunk = uint64_t(1) << 16;
+            pool.parallel_for(static_cast<std::size_t>((header.count + chunk - 1) / chunk), [&](std::size_t task) {
+                const uint64_t end = std::min(header.count, (task + 1) * chunk);
+                for (uint64_t i = task * chunk; i < end; ++i) {
+                    values[i] = reference(static_cast<double>(reference_input(static_cast<uint32_t>(first + i))));
+                }
+            });
+        });
+    }
+
+    // Writes reference(x) for an explicit list of grid inputs
+    template<typename Reference>
+    void write_reference_grid(const char *path, const char *function, Reference reference,
+                              std::span<const float> inputs) {
+        reference_header header{};
+        std::memcpy(header.magic, reference_magic, sizeof(header.magic));
+        header.version = reference_version;
+        header.kind = reference_kind::grid;
+        std::strncpy(header.function, function, sizeof(header.function) - 1);
+        header.count = inputs.size();
+
+        reference_detail::write(path, header, [&](char *payload) {
+            std::memcpy(payload, inputs.data(), inputs.size_bytes());
+            double *values = reinterpret_cast<double *>(payload + reference_detail::inputs_bytes(header));
+            for (std::size_t i = 0; i < inputs.size(); ++i) {
+                values[i] = reference(static_cast<double>(inputs[i]));
+            }
+        });
+    }
+
+    // Read-only mapping of a reference table file. Throws std::runtime_error
+    // if the file is missing, truncated, not a reference table or holds a
+    // different function than the `function` the caller expects.
+    class reference_table {
+    public:
+        reference_table(const char *path, const char *function) {
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) {
+                throw reference_detail::error("cannot open reference table", path);
+            }
+            struct stat info;
+            if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(reference_header)) {
+                ::close(fd);
+                throw reference_detail::error("not a reference table", path);
+            }
+            bytes = static_cast<std::size_t>(info.st_size);
+            map = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (map == MAP_FAILED) {
+                map = nullptr;
+                throw reference_detail::error("cannot map reference table", path);
+            }
+
+            const reference_header& h = header();
+            if (std::memcmp(h.magic, reference_magic, sizeof(h.magic)) != 0 || h.version != reference_version
+                || (h.kind != reference_kind::range && h.kind != reference_kind::grid)
+                || reference_detail::file_bytes(h) != bytes) {
+                release();
+                throw reference_detail::error("not a reference table", path);
+            }
+            if (::strnlen(h.function, sizeof(h.function)) == sizeof(h.function)
+                || std::strcmp(h.function, function) != 0) {
+                release();
+                throw reference_detail::error(std::string("not a reference table for ") + function, path);
+            }
+        }
+
+        ~reference_table() { release(); }
+
+        reference_table(const reference_table&) = delete;
+        reference_table& operator=(const reference_table&) = delete;
+
+        reference_table(reference_table&& other) noexcept
+            : map(std::exchange(other.map, nullptr)), bytes(std::exchange(other.bytes, 0)) {}
+
+        reference_table& operator=(reference_table&& other) noexcept {
+            if (this != &other) {
+                release();
+                map = std::exchange(other.map, nullptr);
+                bytes = std::exchange(other.bytes, 0);
+            }
+            return *this;
+        }
+
+        const reference_header& header() const { return *static_cast<const reference_header *>(map); }
+
+        std::span<const double> values() const {
+            const char *payload = static_cast<const char *>(map) + sizeof(reference_header);
+            return {reinterpret_cast<const double *>(payload + reference_detail::inputs_bytes(header())),
+                    static_cast<std::size_t>(header().count)};
+        }
+
+        // Grid inputs, empty for range tables
+        std::span<const float> inputs() const {
+            if (header().kind != reference_kind::grid) {
+                return {};
+            }
+            const char *payload = static_cast<const char *>(map) + sizeof(reference_header);
+            return {reinterpret_cast<const float *>(payload), static_cast<std::size_t>(header().count)};
+        }
+
+        // Range tables only: whether x has a stored reference, and its value
+        bool covers(float x) const {
+            return header().kind == reference_kind::range
+                && uint64_t(reference_key(x) - header().first_key) < header().count;
+        }
+
+        double operator()(float x) const {
+            return values()[reference_key(x) - header().first_key];
+        }
+
+    private:
+        void release() {
+            if (map) {
+                ::munmap(map, bytes);
+                map = nullptr;
+            }
+        }
+
+        void *map = nullptr;
+        std::size_t bytes = 0;
+    };
+
+    // <directory>/<function>.ref for programs that take an optional
+    // reference directory: nothing if the file isn't there, so they fall
+    // back to computing references, but a file that is there and can't be
+    // used still throws.
+    inline std::optional<reference_table> open_reference_table(const char *directory, const char *function) {
+        const std::string path = std::string(directory) + "/" + function + ".ref";
+        if (::access(path.c_str(), F_OK) != 0) {
+            return std::nullopt;
+        }
+        return std::optional<reference_table>(std::in_place, path.c_str(), function);
+    }
+}
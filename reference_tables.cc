@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "reference_table.hpp"
+
+// Writes the double reference tables accuracy_sweep, optimize_constants,
+// softmax and gaussian can mmap instead of recomputing. Every float in each
+// range gets an entry, so the big ones are 8-17 GB, name the ones you want:
+//   ./reference_tables refs exp tanh exp_grid
+
+struct range_reference {
+    const char *name;
+    double (*function)(double);
+    float lo;
+    float hi;
+};
+
+// Ranges cover the matching accuracy_sweep targets
+const range_reference ranges[] = {
+    {"exp", [](double x) { return std::exp(x); }, -88.0f, 88.0f},
+    {"log2", [](double x) { return std::log2(x); }, 1.17549435e-38f, 3.40282347e+38f},
+    {"tanh", [](double x) { return std::tanh(x); }, -10.0f, 10.0f},
+    {"atanh", [](double x) { return std::atanh(x); }, -1.0f, 1.0f},
+    {"sin", [](double x) { return std::sin(x); }, -1000.0f, 1000.0f},
+    {"gaussian", [](double t) { return std::exp(-t * t / 2); }, -13.0f, 13.0f},
+};
+
+// The -88..88 step 0.1f grid optimize_constants averages over, built the
+// same way so the inputs match bit for bit
+std::vector<float> exp_grid_inputs() {
+    std::vector<float> inputs;
+    for (float x = -88.0f; x <= 88.0f; x += 0.1f) {
+        inputs.push_back(x);
+    }
+    return inputs;
+}
+
+bool selected(int argc, char **argv, const char *name) {
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <directory> <table>...\ntables: exp_grid";
+        for (const auto& range : ranges) {
+            std::cerr << " " << range.name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    const std::string directory = argv[1];
+
+    for (const auto& range : ranges) {
+        if (!selected(argc, argv, range.name)) {
+            continue;
+        }
+        const std::string path = directory + "/" + range.name + ".ref";
+        auto start = std::chrono::steady_clock::now();
+        fast::write_reference_range(path.c_str(), range.name, range.function, range.lo, range.hi);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+        uint64_t count = uint64_t(fast::reference_key(range.hi)) - fast::reference_key(range.lo) + 1;
+        std::cout << std::setprecision(3) << path << ": " << count << " floats in ["
+            << range.lo << ", " << range.hi << "], " << count * sizeof(double) / double(1 << 20)
+            << " MB in " << seconds.count() << " s" << std::endl;
+    }
+
+    if (selected(argc, argv, "exp_grid")) {
+        const std::string path = directory + "/exp_grid.ref";
+        std::vector<float> inputs = exp_grid_inputs();
+        fast::write_reference_grid(path.c_str(), "exp", [](double x) { return std::exp(x); }, inputs);
+        std::cout << path << ": " << inputs.size() << " grid points" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+#include "constexpr_math.hpp"
+
+namespace fast {
+
+    // Remez exchange for minimax polynomials, run at compile time so the
+    // kernels' coefficient tables come straight from the function they
+    // approximate, the C++ side of the fits explore_exp.py and
+    // plot_approx.py tune by hand. The error is measured on a uniform grid
+    // of Grid points, which bounds how exactly the extrema are located but
+    // is plenty for float coefficients.
+    enum class remez_error { absolute, relative };
+
+    template<std::size_t Degree>
+    struct remez_fit {
+        std::array<double, Degree + 1> coefficients; // lowest order first
+        double max_error;
+    };
+
+    namespace remez_detail {
+        constexpr double abs(double x) { return x < 0 ? -x : x; }
+
+        template<std::size_t N>
+        constexpr double horner(const std::array<double, N>& c, double x) {
+            double p = c[N - 1];
+            for (std::size_t i = N - 1; i-- > 0;) {
+                p = p * x + c[i];
+            }
+            return p;
+        }
+
+        // Gauss-Jordan with partial pivoting on an augmented N x (N + 1) matrix
+        template<std::size_t N>
+        constexpr std::array<double, N> solve(std::array<std::array<double, N + 1>, N> m) {
+            for (std::size_t col = 0; col < N; ++col) {
+                std::size_t pivot = col;
+                for (std::size_t row = col + 1; row < N; ++row) {
+                    if (abs(m[row][col]) > abs(m[pivot][col])) {
+                        pivot = row;
+                    }
+                }
+                std::swap(m[col], m[pivot]);
+                for (std::size_t row = 0; row < N; ++row) {
+                    if (row == col) {
+                        continue;
+                    }
+                    double factor = m[row][col] / m[col][col];
+                    for (std::size_t k = col; k <= N; ++k) {
+                        m[row][k] -= factor * m[col][k];
+                    }
+                }
+            }
+            std::array<double, N> x{};
+            for (std::size_t i = 0; i < N; ++i) {
+                x[i] = m[i][N] / m[i][i];
+            }
+            return x;
+        }
+    }
+
+    // Degree `Degree` minimax fit of f on [lo, hi]. Relative error needs f
+    // to stay away from zero on the interval. Throws if the exchange cannot
+    // find Degree + 2 alternating extrema or hasn't settled after
+    // `iterations` rounds, which makes a constexpr fit fail to compile
+    // instead of quietly handing back an unconverged polynomial.
+    template<std::size_t Degree, std::size_t Grid = 1024, typename Func>
+    constexpr remez_fit<Degree> remez(Func f, double lo, double hi, remez_error kind, int iterations = 16) {
+        constexpr std::size_t n = Degree + 2;
+        static_assert(Grid > 4 * n, "grid too coarse to separate the extrema");
+
+        // Only f is kept per grid point, constexpr evaluation gets slow
+        // quickly with large arrays being written over and over
+        std::array<double, Grid> y{};
+        const auto grid_x = [&](std::size_t k) { return lo + (hi - lo) * k / (Grid - 1); };
+        const auto weight = [&](std::size_t k) { return kind == remez_error::relative ? remez_detail::abs(y[k]) : 1.0; };
+        for (std::size_t k = 0; k < Grid; ++k) {
+            y[k] = f(grid_x(k));
+        }
+
+        // Start from the Chebyshev extrema, snapped to the grid
+        std::array<std::size_t, n> reference{};
+        for (std::size_t i = 0; i < n; ++i) {
+            double u = (1.0 - cmath::cos(cmath::pi * i / (n - 1))) / 2;
+            reference[i] = static_cast<std::size_t>(u * (Grid - 1) + 0.5);
+        }
+
+        // A converged fit has exactly n sign runs, a few more can show up
+        // on the way there
+        constexpr std::size_t max_runs = 4 * n;
+        remez_fit<Degree> fit{};
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            // p(x_i) - f(x_i) = (-1)^i E w(x_i) on the reference points
+            std::array<std::array<double, n + 1>, n> system{};
+            for (std::size_t i = 0; i < n; ++i) {
+                double power = 1.0;
+                for (std::size_t j = 0; j <= Degree; ++j) {
+                    system[i][j] = power;
+                    power *= grid_x(reference[i]);
+                }
+                system[i][n - 1] = (i % 2 ? -1.0 : 1.0) * weight(reference[i]);
+                system[i][n] = y[reference[i]];
+            }
+            std::array<double, n> solution = remez_detail::solve<n>(system);
+            for (std::size_t j = 0; j <= Degree; ++j) {
+                fit.coefficients[j] = solution[j];
+            }
+
+            // The largest |error| in each run of one sign
+            std::array<std::size_t, max_runs> extrema{};
+            std::array<double, max_runs> extrema_error{};
+            std::size_t count = 0;
+            fit.max_error = 0.0;
+            for (std::size_t k = 0; k < Grid; ++k) {
+                double error = (remez_detail::horner(fit.coefficients, grid_x(k)) - y[k]) / weight(k);
+                double magnitude = remez_detail::abs(error);
+                fit.max_error = magnitude > fit.max_error ? magnitude : fit.max_error;
+                if (count > 0 && (error >= 0) == (extrema_error[count - 1] >= 0)) {
+                    if (magnitude > remez_detail::abs(extrema_error[count - 1])) {
+                        extrema[count - 1] = k;
+                        extrema_error[count - 1] = error;
+                    }
+                } else if (count < max_runs) {
+                    extrema[count] = k;
+                    extrema_error[count] = error;
+                    ++count;
+                } else {
+                    throw std::runtime_error("remez: error curve has too many sign changes");
+                }
+            }
+
+            // Trim the smaller end until exactly n alternating extrema are left
+            std::size_t first = 0;
+            while (count - first > n) {
+                if (remez_detail::abs(extrema_error[first]) < remez_detail::abs(extrema_error[count - 1])) {
+                    ++first;
+                } else {
+                    --count;
+                }
+            }
+            if (count - first < n) {
+                throw std::runtime_error("remez: too few alternating extrema to exchange");
+            }
+
+            // Nothing moved: converged
+            bool moved = false;
+            for (std::size_t i = 0; i < n; ++i) {
+                moved |= reference[i] != extrema[first + i];
+                reference[i] = extrema[first + i];
+            }
+            if (!moved) {
+                return fit;
+            }
+        }
+        throw std::runtime_error("remez: no convergence within the iteration limit");
+    }
+
+    // The coefficients rounded to float, ready for the kernels' tables
+    template<std::size_t Degree, typename Func>
+    constexpr std::array<float, Degree + 1> minimax_f32(Func f, double lo, double hi, remez_error kind) {
+        remez_fit<Degree> fit = remez<Degree>(f, lo, hi, kind);
+        std::array<float, Degree + 1> coefficients{};
+        for (std::size_t i = 0; i <= Degree; ++i) {
+            coefficients[i] = static_cast<float>(fit.coefficients[i]);
+        }
+        return coefficients;
+    }
+}
@@ -2,128 +2,20 @@
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 
 #include <vector>
 #include <algorithm>
+#include <optional>
 #include <random>
 
 #include "graphs.hpp"
-
-#include <immintrin.h>
-
-namespace fast {
-
-#pragma clang attribute push (__attribute__((target("avx,avx2,fma"))), apply_to=function)
-    float exp(float x) {
-
-        //float magic = 214760456192.0f; // more accurate for large values, loses significant precision for small values
-        float magic = 12102203.2f; // approx. (2^23) * log2(e)
-        float integer_1 = 0x3F7A8480; // 1.0f, converted to a float
-        return std::bit_cast<float>((int32_t)(std::fma(magic, x, integer_1)));
-    }
-
-    float weird_log(float x) {
-        const float curvature = 36707.375f; // optimized value
-        return std::bit_cast<float>((uint32_t)(-0x3f800000 - curvature*x)) + 7;
-    }
-
-    float log(float x) {
-        const float magic_scale = 8.26295831757307e-08f; // float epsilon * ln(2)
-        const int32_t offset = std::bit_cast<int32_t>(1.0f); // 0x3f800000
-        int32_t i = std::bit_cast<int32_t>(x);
-        return magic_scale * (float)(i - offset);
-    }
-
-        float approx_log2_interpolated_2bit(float x) {
-            uint32_t i = std::bit_cast<uint32_t>(x);
-
-            int32_t exponent = static_cast<int32_t>((i >> 23) & 0xFF) - 127;
-            
-            uint32_t mantissa_bits = (i & 0x007FFFFF) | 0x3F800000;
-            float m = std::bit_cast<float>(mantissa_bits);
-
-            // 3. 2-bit Table (2^2 = 4 entries + 1 for boundary)
-            // table[i] = log2(1 + i/4)
-            static constexpr float table[5] = {
-                0.00000000f, // log2(1.00)
-                0.32192809f, // log2(1.25)
-                0.58496250f, // log2(1.50)
-                0.80735492f, // log2(1.75)
-                1.00000000f  // log2(2.00) - for easy interpolation
-            };
-
-            float f = m - 1.0f;
-            float scaled_f = f * 4.0f;
-            int index = static_cast<int>(scaled_f);
-            float fraction = scaled_f - static_cast<float>(index);
-
-            float log2_mantissa = table[index] + fraction * (table[index + 1] - table[index]);
-
-            return static_cast<float>(exponent) + log2_mantissa;
-        }
-
-    float softmax(std::vector<float>& input) {
-        auto max_val = *std::max_element(input.begin(), input.end());
-        float sum = 0.0f;
-        std::transform(input.begin(), input.end(), input.begin(),
-        [max_val, &sum](float val) {
-            float exp_val = fast::exp(val - max_val);
-            sum += exp_val;
-            return exp_val;
-        });
-
-        float inv_sum = 1.0 / sum;
-        std::transform(input.begin(), input.end(), input.begin(),
-            [inv_sum](float val) { return val * inv_sum; });
-
-        return sum;
-    }
-
-    __m256 avx2_exp_f32(__m256 x) {
-        const __m256 magic = _mm256_set1_ps(12102203.2f);
-        const __m256 offset = _mm256_set1_ps(0x3f800000);
-
-        return _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_fmadd_ps(magic, x, offset)));
-        return x;
-    }
-
-
-    float avx2_softmax_f32(const std::size_t n, float *y, float *x, float max) {
-        std::size_t i = 0;
-        float sum = 0;
-        // We have a full 256 bit lane available
-        for(; i + 7 < n; i += 8) {
-            __m256 val = avx2_exp_f32(_mm256_sub_ps(_mm256_loadu_ps(x+i), _mm256_set1_ps(max)));
-            _mm256_storeu_ps(y + i, val);
-
-            // _mm256_reduce_add_ps() doesn't exist, so instead extract the results
-            // 128 bits at a time
-            __m128 val2 = _mm_add_ps(_mm256_extractf128_ps(val, 1),
-                                    _mm256_castps256_ps128(val));
-            val2 = _mm_add_ps(val2, _mm_movehl_ps(val2, val2));
-            val2 = _mm_add_ss(val2, _mm_movehdup_ps(val2));
-            sum += (float)_mm_cvtss_f32(val2);
-        }
-
-        for (; i < n; ++i) {
-            float val = fast::exp(x[i] - max);
-            sum += val;
-            y[i] = val;
-        }
-
-        return sum;
-    }
-
-    float vec_softmax(std::vector<float> input) {
-        auto max_val = *std::max_element(input.begin(), input.end());
-        decltype(input) output(input.size());
-        return fast::avx2_softmax_f32(input.size(), output.data(), input.data(), max_val);
-    }
-}
-
-#if defined(__clang__)
-#pragma clang attribute pop
-#endif
+#include "fast_math.hpp"
+#include "fast_pow.hpp"
+#include "remez.hpp"
+#include "fast_tanh.hpp"
+#include "fast_trig.hpp"
+#include "reference_table.hpp"
 
 float softmax(std::vector<float>& input) {
     auto max_val = *std::max_element(input.begin(), input.end());
@@ -143,6 +35,14 @@ float softmax(std::vector<float>& input) {
 }
 
 
+// exp.ref from reference_tables when main() was given a directory holding
+// one, the exp sweeps below then read their references from it
+std::optional<fast::reference_table> exp_table;
+
+float reference_exp(float x) {
+    return exp_table && exp_table->covers(x) ? static_cast<float>((*exp_table)(x)) : std::exp(x);
+}
+
 void test_exp() {
 
     for (float x = -110.0f; x <= 90.0f; x+= 1.0f) {
@@ -175,6 +75,206 @@ void test_log() {
 
 }
 
+void test_exp_interp2() {
+    float max_error = 0.0f;
+    float max_error_schraudolph = 0.0f;
+    for (float x = -80.0f; x <= 80.0f; x += 0.01f) {
+        float true_value = reference_exp(x);
+        max_error = std::max(max_error, std::fabs(true_value - fast::exp_interp2(x)) / true_value);
+        max_error_schraudolph = std::max(max_error_schraudolph, std::fabs(true_value - fast::exp(x)) / true_value);
+    }
+
+    std::cout << std::setprecision(15)
+        << "exp_interp2 max rel error: " << max_error
+        << "\nexp max rel error: " << max_error_schraudolph << std::endl;
+}
+
+template<typename Tier>
+void test_exp_tier(const char *name) {
+    std::vector<float> xs;
+    float max_error = 0.0f;
+    for (float x = -87.0f; x <= 88.0f; x += 0.001f) {
+        float true_value = reference_exp(x);
+        max_error = std::max(max_error, std::fabs(true_value - fast::exp<Tier>(x)) / true_value);
+        xs.push_back(x);
+    }
+
+    std::cout << std::setprecision(6) << name << " max rel error: " << max_error
+        << " (documented " << Tier::max_rel_error << ")" << std::endl;
+
+    // The vector forms should stay within the same bound
+    std::vector<float> ys(xs.size());
+    auto vector_error = [&]() {
+        float error = 0.0f;
+        for (size_t i = 0; i < xs.size(); i++) {
+            float true_value = reference_exp(xs[i]);
+            error = std::max(error, std::fabs(true_value - ys[i]) / true_value);
+        }
+        return error;
+    };
+    if (fast::isa_supported(fast::isa::avx2)) {
+        fast::avx2_exp_f32<Tier>(xs.size(), ys.data(), xs.data());
+        std::cout << "  avx2 max rel error: " << vector_error() << std::endl;
+    }
+    if (fast::isa_supported(fast::isa::avx512)) {
+        fast::avx512_exp_f32<Tier>(xs.size(), ys.data(), xs.data());
+        std::cout << "  avx512 max rel error: " << vector_error() << std::endl;
+    }
+}
+
+void test_tanh() {
+    float max_error_tanh = 0.0f;
+    for (float x = -10.0f; x <= 10.0f; x += 0.001f) {
+        float true_value = std::tanh(x);
+        if (true_value != 0.0f) {
+            max_error_tanh = std::max(max_error_tanh, std::fabs(true_value - fast::tanh(x)) / std::fabs(true_value));
+        }
+    }
+
+    float max_error_atanh = 0.0f;
+    for (float x = -0.999f; x <= 0.999f; x += 0.0001f) {
+        float true_value = std::atanh(x);
+        if (true_value != 0.0f) {
+            max_error_atanh = std::max(max_error_atanh, std::fabs(true_value - fast::atanh(x)) / std::fabs(true_value));
+        }
+    }
+
+    std::cout << std::setprecision(6)
+        << "tanh max rel error: " << max_error_tanh
+        << "\natanh max rel error: " << max_error_atanh << std::endl;
+}
+
+void test_trig() {
+    float max_error_sin = 0.0f;
+    float max_error_cos = 0.0f;
+    for (float x = -1000.0f; x <= 1000.0f; x += 0.001f) {
+        max_error_sin = std::max(max_error_sin, std::fabs(std::sin(x) - fast::sin(x)));
+        max_error_cos = std::max(max_error_cos, std::fabs(std::cos(x) - fast::cos(x)));
+    }
+
+    std::cout << std::setprecision(6)
+        << "sin max abs error: " << max_error_sin
+        << "\ncos max abs error: " << max_error_cos << std::endl;
+}
+
+// tanh and atanh pass NaN through and saturate for +-inf, on the vector
+// path too: the first ymm holds NaN in every other lane, the tail one NaN
+void test_tanh_special() {
+    std::vector<float> x(9);
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] = i % 2 == 0 ? NAN : (i % 4 == 1 ? INFINITY : -INFINITY);
+    }
+
+    std::vector<float> t(x.size()), a(x.size());
+    if (fast::isa_supported(fast::isa::avx2)) {
+        fast::avx2_tanh_f32(x.size(), t.data(), x.data());
+        fast::avx2_atanh_f32(x.size(), a.data(), x.data());
+    } else {
+        fast::scalar_tanh_f32(x.size(), t.data(), x.data());
+        fast::scalar_atanh_f32(x.size(), a.data(), x.data());
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (std::isnan(x[i])) {
+            for (float val : {fast::tanh(x[i]), fast::atanh(x[i]), t[i], a[i]}) {
+                ok = ok && std::isnan(val);
+            }
+        } else {
+            for (float val : {fast::tanh(x[i]), t[i]}) {
+                ok = ok && std::fabs(val - std::copysign(1.0f, x[i])) <= 1e-6f;
+            }
+            for (float val : {fast::atanh(x[i]), a[i]}) {
+                ok = ok && std::isfinite(val) && std::signbit(val) == std::signbit(x[i]);
+            }
+        }
+    }
+
+    std::cout << "tanh/atanh NaN and inf inputs: " << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+// Outside the accurate range sin and cos only promise std::sin's NaN for
+// NaN and inf, and some value in [-1, 1] for huge finite x
+void test_trig_special() {
+    const std::vector<float> special = {NAN, INFINITY, -INFINITY};
+    const std::vector<float> huge = {3.5e9f, -3.5e9f, 1e20f, std::numeric_limits<float>::max(),
+                                     -std::numeric_limits<float>::max(), 8388609.0f, 1e5f};
+
+    std::vector<float> x(special);
+    x.insert(x.end(), huge.begin(), huge.end());
+    // Pad to a full ymm so the AVX2 path sees every value
+    x.resize(16, 1e30f);
+
+    std::vector<float> s(x.size()), c(x.size()), vs(x.size()), vc(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        s[i] = fast::sin(x[i]);
+        c[i] = fast::cos(x[i]);
+    }
+    if (fast::isa_supported(fast::isa::avx2)) {
+        fast::avx2_sincos_f32(x.size(), vs.data(), vc.data(), x.data());
+    } else {
+        fast::scalar_sincos_f32(x.size(), vs.data(), vc.data(), x.data());
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < x.size(); i++) {
+        for (float val : {s[i], c[i], vs[i], vc[i]}) {
+            ok = ok && (i < special.size() ? std::isnan(val) : std::fabs(val) <= 1.0f);
+        }
+    }
+
+    std::cout << "sin/cos NaN, inf and huge inputs: " << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+void test_pow() {
+    const float gamma = 2.2f;
+    float max_error_lut = 0.0f;
+    float max_error_logexp = 0.0f;
+    for (float x = 0.01f; x <= 1.0f; x += 0.0001f) {
+        float true_value = std::pow(x, gamma);
+        max_error_lut = std::max(max_error_lut, std::fabs(true_value - fast::pow_lut(x, gamma)));
+        max_error_logexp = std::max(max_error_logexp, std::fabs(true_value - fast::pow_logexp(x, gamma)) / true_value);
+    }
+
+    std::cout << std::setprecision(6)
+        << "pow_lut max abs error: " << max_error_lut
+        << "\npow_logexp max rel error: " << max_error_logexp << std::endl;
+}
+
+// fast_math.hpp ships the fitted coefficients as plain constants so the
+// fit doesn't run in every TU that includes it. Refit them here, once, and
+// fail the build if they drifted.
+constexpr auto remez_exp2 = [](double f) { return fast::cmath::exp2(f); };
+constexpr auto remez_log2 = [](double f) { return fast::cmath::log2(1.0 + f); };
+static_assert(fast::minimax_f32<2>(remez_exp2, 0.0, 1.0, fast::remez_error::relative) == fast::exp_tier::exp2_minimax_2);
+static_assert(fast::minimax_f32<3>(remez_exp2, 0.0, 1.0, fast::remez_error::relative) == fast::exp_tier::exp2_minimax_3);
+static_assert(fast::minimax_f32<4>(remez_exp2, 0.0, 1.0, fast::remez_error::relative) == fast::exp_tier::exp2_minimax_4);
+static_assert(fast::minimax_f32<5>(remez_log2, 0.0, 1.0, fast::remez_error::absolute) == fast::log2_minimax_5);
+
+// Remez fits for the four mantissa corrections, run at runtime here
+void test_remez() {
+    using fast::remez_error;
+    auto exp2 = fast::remez<3>([](double x) { return fast::cmath::exp2(x); }, 0.0, 1.0, remez_error::relative);
+    auto log2 = fast::remez<5>([](double x) { return fast::cmath::log2(1.0 + x); }, 0.0, 1.0, remez_error::absolute);
+    auto sin = fast::remez<5>([](double x) { return fast::cmath::sin(x * fast::cmath::pi / 2); }, 0.0, 1.0, remez_error::absolute);
+    auto tanh = fast::remez<7>([](double x) { return fast::cmath::tanh(x); }, 0.0, 1.0, remez_error::absolute);
+
+    std::cout << std::setprecision(6)
+        << "remez exp2 degree 3 max rel error: " << exp2.max_error
+        << "\nremez log2 degree 5 max abs error: " << log2.max_error
+        << "\nremez sin degree 5 max abs error: " << sin.max_error
+        << "\nremez tanh degree 7 max abs error: " << tanh.max_error << std::endl;
+}
+
+void test_exp_tiers() {
+    test_exp_tier<fast::exp_tier::schraudolph>("schraudolph");
+    test_exp_tier<fast::exp_tier::interp2>("interp2");
+    test_exp_tier<fast::exp_tier::correct1>("correct1");
+    test_exp_tier<fast::exp_tier::correct2>("correct2");
+    test_exp_tier<fast::exp_tier::correct3>("correct3");
+    test_exp_tier<fast::exp_tier::precise>("precise");
+}
+
 std::vector<float> generate_random_data(size_t size) {
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -192,14 +292,199 @@ void test_softmax() {
     auto vec2{vec};
 
     float fast_sum = fast::vec_softmax(vec);
-    float true_sum = softmax(vec);
+    float true_sum = softmax(vec2);
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < vec.size(); i++) {
+        max_error = std::max(max_error, std::fabs(vec[i] - vec2[i]));
+    }
 
     std::cout << std::setprecision(15) << "fast_sum: " << fast_sum 
     << "\ntrue_sum: " << true_sum
-    << "\nrel_error:" << std::fabs(true_sum - fast_sum) / true_sum << std::endl;
+    << "\nrel_error:" << std::fabs(true_sum - fast_sum) / true_sum
+    << "\nmax_abs_error:" << max_error << std::endl;
+}
+
+// Vocab-sized row whose logits span more than 88, so most exp(x - max)
+// fall below the float range and have to come out as 0
+void test_softmax_wide_spread() {
+    std::vector<float> vec(50257, 0.0f);
+    vec[0] = 100.0f;
+    vec[1] = -10.0f;
+    auto expected{vec};
+    softmax(expected);
+
+    for (fast::isa level : {fast::isa::scalar, fast::isa::sse41, fast::isa::avx2, fast::isa::avx512}) {
+        if (!fast::isa_supported(level)) {
+            continue;
+        }
+
+        const fast::kernel_table k = fast::make_kernel_table(level);
+        std::vector<float> actual(vec.size());
+        float max = k.max_f32(vec.size(), vec.data());
+        float sum = k.softmax_f32(vec.size(), actual.data(), vec.data(), max);
+        k.scale_f32(vec.size(), actual.data(), 1.0f / sum);
+
+        float max_error = 0.0f;
+        for (size_t i = 0; i < vec.size(); i++) {
+            max_error = std::max(max_error, std::fabs(expected[i] - actual[i]));
+        }
+
+        std::cout << std::setprecision(15) << fast::isa_name(level)
+        << " wide spread sum: " << sum
+        << "\n  max_abs_error:" << max_error << std::endl;
+    }
+}
+
+// The online and three-pass sums take the Schraudolph exp of different
+// offsets, so each can be off by its error in opposite directions
+bool online_sum_close(float online_sum, float three_pass_sum) {
+    const float tolerance = 2 * fast::exp_tier::schraudolph::max_rel_error;
+    return std::fabs(online_sum - three_pass_sum) <= tolerance * three_pass_sum;
 }
 
-int main() {
+void test_online_softmax() {
+    auto vec = generate_random_data(5000);
+    std::vector<float> expected(vec.size());
+    std::vector<float> actual(vec.size());
+
+    float expected_sum = fast::softmax(vec.size(), expected.data(), vec.data());
+
+    // Uneven chunks so the running max has to be rescaled along the way
+    fast::online_softmax state;
+    for (size_t i = 0, chunk = 1; i < vec.size(); i += chunk, chunk = chunk * 3 + 1) {
+        state.update(std::min(chunk, vec.size() - i), vec.data() + i);
+    }
+    state.normalize(vec.size(), actual.data(), vec.data());
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < vec.size(); i++) {
+        max_error = std::max(max_error, std::fabs(expected[i] - actual[i]));
+    }
+
+    std::cout << std::setprecision(15) << "online_sum: " << state.sum()
+    << "\nthree_pass_sum: " << expected_sum
+    << "\nmax_abs_error:" << max_error
+    << "\nonline sum within tolerance: " << (online_sum_close(state.sum(), expected_sum) ? "ok" : "FAILED")
+    << std::endl;
+}
+
+// Decoder steps: one element at a time on a rising row, so the max grows
+// and the running sum is rescaled on every update
+void test_online_softmax_decoder() {
+    for (size_t n : {100, 1000}) {
+        std::vector<float> vec(n);
+        for (size_t i = 0; i < n; i++) {
+            vec[i] = static_cast<float>(i) * 0.01f;
+        }
+        std::vector<float> expected(n);
+        float expected_sum = fast::softmax(n, expected.data(), vec.data());
+
+        fast::online_softmax state;
+        for (float x : vec) {
+            state.update(x);
+        }
+        std::vector<float> actual(n);
+        state.normalize(n, actual.data(), vec.data());
+        float total = 0.0f;
+        for (float p : actual) {
+            total += p;
+        }
+
+        bool ok = online_sum_close(state.sum(), expected_sum) && online_sum_close(total, 1.0f);
+        std::cout << std::setprecision(15) << "decoder steps n=" << n
+        << " online_sum: " << state.sum()
+        << ", three_pass_sum: " << expected_sum
+        << ", normalized sum: " << total
+        << (ok ? " ok" : " FAILED") << std::endl;
+    }
+}
+
+// The second half's max is more than 88 above the first half's, so the
+// running sum has to be rescaled by a factor below the float range
+void test_online_softmax_max_jump() {
+    auto vec = generate_random_data(4096);
+    for (size_t i = vec.size() / 2; i < vec.size(); i++) {
+        vec[i] += 100.0f;
+    }
+    const size_t half = vec.size() / 2;
+    std::vector<float> expected(vec.size());
+    float expected_sum = fast::softmax(vec.size(), expected.data(), vec.data());
+
+    fast::online_softmax updated;
+    updated.update(half, vec.data());
+    updated.update(vec.size() - half, vec.data() + half);
+
+    fast::online_softmax low;
+    fast::online_softmax high;
+    low.update(half, vec.data());
+    high.update(vec.size() - half, vec.data() + half);
+    fast::online_softmax merged_up = low;
+    merged_up.merge(high);
+    fast::online_softmax merged_down = high;
+    merged_down.merge(low);
+    merged_down.merge(fast::online_softmax());
+
+    bool ok = online_sum_close(updated.sum(), expected_sum) && online_sum_close(merged_up.sum(), expected_sum)
+        && online_sum_close(merged_down.sum(), expected_sum);
+    std::cout << std::setprecision(15) << "max jump three_pass_sum: " << expected_sum
+    << "\n  update_sum: " << updated.sum()
+    << "\n  merge_up_sum: " << merged_up.sum()
+    << "\n  merge_down_sum: " << merged_down.sum()
+    << "\n  " << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+void test_log_softmax() {
+    auto vec = generate_random_data(1000);
+    std::vector<float> actual(vec.size());
+
+    float max_val = *std::max_element(vec.begin(), vec.end());
+    double true_sum = 0.0;
+    for (float val : vec) {
+        true_sum += std::exp(static_cast<double>(val - max_val));
+    }
+    double true_lse = max_val + std::log(true_sum);
+
+    float fast_lse = fast::log_softmax(vec.size(), actual.data(), vec.data());
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < vec.size(); i++) {
+        max_error = std::max(max_error, static_cast<float>(std::fabs((vec[i] - true_lse) - actual[i])));
+    }
+
+    std::cout << std::setprecision(15) << "true_logsumexp: " << true_lse
+    << "\nfast_logsumexp: " << fast_lse
+    << "\nlog_softmax max_abs_error:" << max_error << std::endl;
+}
+
+void test_softmax_rows() {
+    const size_t rows = 300;
+    const size_t cols = 77;
+    const size_t stride = 80;
+    auto matrix = generate_random_data(rows * stride);
+    std::vector<float> actual(rows * stride);
+
+    fast::thread_pool pool(4);
+    fast::softmax_rows(rows, cols, stride, matrix.data(), actual.data(), pool);
+
+    float max_error = 0.0f;
+    std::vector<float> expected(cols);
+    for (size_t r = 0; r < rows; r++) {
+        fast::softmax(cols, expected.data(), matrix.data() + r * stride);
+        for (size_t c = 0; c < cols; c++) {
+            max_error = std::max(max_error, std::fabs(expected[c] - actual[r * stride + c]));
+        }
+    }
+
+    std::cout << std::setprecision(15) << "softmax_rows max_abs_error: " << max_error << std::endl;
+}
+
+// Optionally pass a directory of reference_tables output to take the exp
+// references from exp.ref
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		exp_table = fast::open_reference_table(argv[1], "exp");
+	}
 
 	size_t height = 160;
 	size_t width = 160;
@@ -214,8 +499,24 @@ int main() {
 	std::function<float(float)> functions[] = {te, fe};
     graphs::functions(height, width, xmin, xmax, ymin, ymax, 2, functions);
     
+    std::cout << "Using " << fast::isa_name(fast::kernels().level) << " kernels" << std::endl;
+
     test_exp();
+    test_exp_interp2();
+    test_exp_tiers();
+    test_remez();
+    test_tanh();
+    test_tanh_special();
+    test_trig();
+    test_trig_special();
+    test_pow();
     //test_log();
     test_softmax();
+    test_softmax_wide_spread();
+    test_online_softmax();
+    test_online_softmax_decoder();
+    test_online_softmax_max_jump();
+    test_softmax_rows();
+    test_log_softmax();
     return 0;
 }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fast {
+
+    // Fixed set of worker threads that stay parked between jobs, so kernels
+    // can fan out without paying for thread creation on every call. The
+    // calling thread works on the job too, so a pool of size 1 has no
+    // workers and runs everything inline.
+    class thread_pool {
+    public:
+        explicit thread_pool(std::size_t threads = default_threads()) {
+            for (std::size_t i = 1; i < threads; ++i) {
+                workers.emplace_back([this] { worker_loop(); });
+            }
+        }
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        std::size_t size() const { return workers.size() + 1; }
+
+        // Calls fn(i) for every i in [0, tasks) and returns once all of them
+        // are done. Tasks are handed out dynamically so uneven tasks still
+        // balance. Not reentrant: fn must not call parallel_for on the same pool.
+        template<typename F>
+        void parallel_for(std::size_t tasks, F&& fn) {
+            if (workers.empty() || tasks <= 1) {
+                for (std::size_t i = 0; i < tasks; ++i) {
+                    fn(i);
+                }
+                return;
+            }
+
+            std::lock_guard<std::mutex> submit(submit_mutex);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job_context = &fn;
+                job_call = [](void *context, std::size_t i) { (*static_cast<F *>(context))(i); };
+                job_tasks = tasks;
+                next_task.store(0, std::memory_order_relaxed);
+                active_workers = workers.size();
+                ++generation;
+            }
+            wake.notify_all();
+
+            run_tasks();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return active_workers == 0; });
+        }
+
+        static std::size_t default_threads() {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // Shared pool sized to the machine, created on first use
+        static thread_pool& global() {
+            static thread_pool pool;
+            return pool;
+        }
+
+    private:
+        void run_tasks() {
+            std::size_t i;
+            while ((i = next_task.fetch_add(1, std::memory_order_relaxed)) < job_tasks) {
+                job_call(job_context, i);
+            }
+        }
+
+        void worker_loop() {
+            uint64_t seen = 0;
+            for (;;) {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                lock.unlock();
+
+                run_tasks();
+
+                lock.lock();
+                if (--active_workers == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex submit_mutex;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping = false;
+        uint64_t generation = 0;
+        std::size_t active_workers = 0;
+
+        void *job_context = nullptr;
+        void (*job_call)(void *, std::size_t) = nullptr;
+        std::size_t job_tasks = 0;
+        std::atomic<std::size_t> next_task{0};
+    };
+}
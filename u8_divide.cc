@@ -3,8 +3,13 @@
 #include <iomanip>
 #include <cstdint>
 #include <bit>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
 
 #include "graphs.hpp"
+#include "fast_divide.hpp"
 
 
 uint8_t correct_int_divide(float a, float b) {
@@ -21,7 +26,6 @@ uint8_t fast_int_divide(float a, float b) {
 
 static uint32_t magic_constant = 0x7f000000;
 //static float magic_scale = 1.10762596130371;
-static float magic_scale2 = 1.00100016593933;
 static float integer_1 = 1064782016; // 1.0f, converted to a float
 static uint32_t magic_mask = 0x7eb504f3;
 static float magic_number = 1.38535642623901;
@@ -93,28 +97,38 @@ float proper_divide2(uint8_t a, uint8_t b) {
 //     return y;
 // }
 
-float reciprocal_1_f (float x){
-    int i = *(int*)&x;
-    i = 0x7eb504f3 - i;
-    float y = *(float*)&i;
+// The divide hacks take the constants they are tuned by as trailing
+// arguments, defaulting to the values they ship with, so the constant
+// search below runs these exact functions.
+float reciprocal_1_f (float x, uint32_t mask = 0x7eb504f3){
+    int i = std::bit_cast<int>(x);
+    i = mask - i;
+    float y = std::bit_cast<float>(i);
     y = 1.94285123*y*fmaf(-x, y, 1.43566f);
     return y;
 }
 
-uint8_t magic_divide(uint8_t a, uint8_t b) {
+uint8_t magic_divide(uint8_t a, uint8_t b, float scale = scalar) {
     float x = static_cast<float>(b);
     //int i = 0x7eb504f3 - *reinterpret_cast<int*>(&x);
-    float y = x * scalar;
+    float y = x * scale;
     float inverse = y * (2 - y*x);
     return a*inverse;
 }
 
 
-uint8_t approx_magic_divide(uint8_t a, uint8_t b) {
+uint8_t approx_magic_divide(uint8_t a, uint8_t b, uint32_t mask = 0x7eb504f3, float number = 1.385356f) {
     float x = static_cast<float>(b);
-    int i = 0x7eb504f3 - *reinterpret_cast<int*>(&x);
+    int i = mask - std::bit_cast<int>(x);
     float reciprocal = std::bit_cast<float>(i);
-    reciprocal = 1.385356f*reciprocal;
+    reciprocal = number*reciprocal;
+    return a*reciprocal;
+}
+
+// reciprocal_1_f scaled by `number` so it lands just above 1/b and
+// truncation rounds exact multiples right
+uint8_t reciprocal_divide(uint8_t a, uint8_t b, uint32_t mask = 0x7eb504f3, float number = 1.0f) {
+    float reciprocal = number*reciprocal_1_f(static_cast<float>(b), mask);
     return a*reciprocal;
 }
 
@@ -134,6 +148,386 @@ size_t test_u8_divide() {
     return num_failed;
 }
 
+// All 65536 (a, b) pairs through the AVX2 kernel, b = 0 included
+size_t test_avx2_u8_divide() {
+    std::vector<uint8_t> a(256 * 256), b(256 * 256), q(256 * 256);
+    for (int i = 0; i < (256*256); i++) {
+        a[i] = static_cast<uint8_t>(i & 0xFF);
+        b[i] = static_cast<uint8_t>(i >> 8);
+    }
+    fast::avx2_divide_u8(q.size(), q.data(), a.data(), b.data());
+
+    size_t num_failed = 0;
+    for (int i = 0; i < (256*256); i++) {
+        if (q[i] != correct_int_divide(a[i], b[i])) {
+            num_failed++;
+        }
+    }
+    return num_failed;
+}
+
+// Same pairs as test_u8_divide, grouped by divisor so each fast::divider_u8
+// is built once and runs the whole numerator range through both the
+// dispatched bulk path and the scalar one
+size_t test_divider_u8() {
+    std::vector<uint8_t> a(256), q(256);
+    for (int i = 0; i < 256; i++) {
+        a[i] = static_cast<uint8_t>(i);
+    }
+
+    size_t num_failed = 0;
+    for (int divisor = 1; divisor < 256; divisor++) {
+        const fast::divider_u8 d(static_cast<uint8_t>(divisor));
+        d.divide(a.size(), q.data(), a.data());
+        for (int i = 0; i < 256; i++) {
+            const uint8_t result = correct_int_divide(i, divisor);
+            if (q[i] != result || d.divide(a[i]) != result) {
+                num_failed++;
+            }
+        }
+    }
+    return num_failed;
+}
+
+// Every one of the 2^32 (a, b) u16 pairs, b = 0 included. Each task is
+// one divisor against all 65536 numerators so the work splits evenly over
+// the pool.
+size_t verify_u16_divide(fast::thread_pool& pool = fast::thread_pool::global()) {
+    std::vector<uint16_t> a(1 << 16);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = static_cast<uint16_t>(i);
+    }
+
+    std::atomic<size_t> num_failed{0};
+    pool.parallel_for(1 << 16, [&](size_t divisor) {
+        std::vector<uint16_t> b(a.size(), static_cast<uint16_t>(divisor)), q(a.size());
+        fast::divide_u16(a.size(), q.data(), a.data(), b.data());
+
+        // a counts up from 0, so the expected quotient goes up by one every
+        // `divisor` steps, no reference divide needed
+        size_t failed = 0;
+        uint16_t result = 0;
+        size_t remainder = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            failed += q[i] != result;
+            if (divisor && ++remainder == divisor) {
+                remainder = 0;
+                result++;
+            }
+        }
+        num_failed += failed;
+    });
+    return num_failed;
+}
+
+// u32 can't be swept, so random pairs at every magnitude plus the edges
+size_t test_u32_divide() {
+    std::mt19937 gen(546);
+    std::vector<uint32_t> a, b;
+    const uint32_t edges[] = {0u, 1u, 2u, 3u, 0x7FFFFFFFu, 0x80000000u, 0x80000001u, 0xFFFFFFFEu, 0xFFFFFFFFu};
+    for (uint32_t x : edges) {
+        for (uint32_t y : edges) {
+            a.push_back(x);
+            b.push_back(y);
+        }
+    }
+    for (int i = 0; i < (1 << 22); i++) {
+        a.push_back(gen() >> (gen() & 31));
+        b.push_back(gen() >> (gen() & 31));
+    }
+
+    std::vector<uint32_t> q(a.size());
+    fast::divide_u32(a.size(), q.data(), a.data(), b.data());
+
+    size_t num_failed = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        const uint32_t result = b[i] ? a[i] / b[i] : 0;
+        num_failed += q[i] != result;
+    }
+    return num_failed;
+}
+
+// Every (channel, alpha) and (base, blend) pair, with the three colour
+// channels holding different values so a lane mix-up would show, checked
+// against plain integer division
+size_t test_rgba8_divide() {
+    const size_t pixels = 256 * 256;
+    std::vector<uint8_t> in(4 * pixels), other(4 * pixels), out(4 * pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        const uint8_t c = static_cast<uint8_t>(i & 0xFF);
+        const uint8_t a = static_cast<uint8_t>(i >> 8);
+        in[4 * i + 0] = c;
+        in[4 * i + 1] = static_cast<uint8_t>(255 - c);
+        in[4 * i + 2] = static_cast<uint8_t>(c / 2);
+        in[4 * i + 3] = a;
+        for (size_t k = 0; k < 4; k++) {
+            other[4 * i + k] = a;
+        }
+    }
+
+    const auto expected = [](int c, int d, int if_zero) {
+        return d ? std::min(c * 255 / d, 255) : if_zero;
+    };
+
+    size_t num_failed = 0;
+    fast::unpremultiply_rgba8(pixels, out.data(), in.data());
+    for (size_t i = 0; i < 4 * pixels; i++) {
+        const uint8_t a = in[i | 3];
+        const int result = (i & 3) == 3 ? a : expected(in[i], a, 0);
+        num_failed += out[i] != result;
+    }
+
+    fast::divide_blend_rgba8(pixels, out.data(), in.data(), other.data());
+    for (size_t i = 0; i < 4 * pixels; i++) {
+        const int result = (i & 3) == 3 ? in[i] : expected(in[i], other[i], 255);
+        num_failed += out[i] != result;
+    }
+    return num_failed;
+}
+
+/* ------------------------- constant search ------------------------- */
+
+// The constants the divide hacks above are tuned by. Each family only
+// reads the ones it needs.
+struct divide_constants {
+    float scalar;
+    uint32_t magic_mask;
+    float magic_number;
+};
+
+// Each family's scalar() is the divide hack itself, so whatever passes is
+// exact for the function above as it ships. avx2() divides 8 numerators by
+// one broadcast divisor op for op the same way, it is only trusted for a
+// candidate after it matched the scalar kernel on every pair.
+namespace divide_family {
+
+    struct newton {
+        static constexpr const char *name = "magic_divide";
+
+        static int scalar(int a, int b, const divide_constants& c) {
+            return magic_divide(a, b, c.scalar);
+        }
+
+        FAST_TARGET_AVX2 static __m256i avx2(__m256 a, __m256 b, const divide_constants& c) {
+            __m256 y = _mm256_mul_ps(b, _mm256_set1_ps(c.scalar));
+            __m256 inverse = _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(y, b)));
+            return _mm256_cvttps_epi32(_mm256_mul_ps(a, inverse));
+        }
+    };
+
+    struct magic_reciprocal {
+        static constexpr const char *name = "approx_magic_divide";
+
+        static int scalar(int a, int b, const divide_constants& c) {
+            return approx_magic_divide(a, b, c.magic_mask, c.magic_number);
+        }
+
+        FAST_TARGET_AVX2 static __m256i avx2(__m256 a, __m256 b, const divide_constants& c) {
+            __m256 y = _mm256_castsi256_ps(_mm256_sub_epi32(_mm256_set1_epi32(c.magic_mask), _mm256_castps_si256(b)));
+            return _mm256_cvttps_epi32(_mm256_mul_ps(a, _mm256_mul_ps(_mm256_set1_ps(c.magic_number), y)));
+        }
+    };
+
+    struct refined_reciprocal {
+        static constexpr const char *name = "reciprocal_divide";
+
+        static int scalar(int a, int b, const divide_constants& c) {
+            return reciprocal_divide(a, b, c.magic_mask, c.magic_number);
+        }
+
+        // reciprocal_1_f's refinement step is done in double, from its
+        // double 1.94285123 literal
+        FAST_TARGET_AVX2 static __m256d avx2_refine(__m128 b, __m128 y) {
+            __m128 step = _mm_fnmadd_ps(b, y, _mm_set1_ps(1.43566f));
+            return _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(1.94285123), _mm256_cvtps_pd(y)), _mm256_cvtps_pd(step));
+        }
+
+        FAST_TARGET_AVX2 static __m256i avx2(__m256 a, __m256 b, const divide_constants& c) {
+            __m256 y = _mm256_castsi256_ps(_mm256_sub_epi32(_mm256_set1_epi32(c.magic_mask), _mm256_castps_si256(b)));
+            __m128 lo = _mm256_cvtpd_ps(avx2_refine(_mm256_castps256_ps128(b), _mm256_castps256_ps128(y)));
+            __m128 hi = _mm256_cvtpd_ps(avx2_refine(_mm256_extractf128_ps(b, 1), _mm256_extractf128_ps(y, 1)));
+            y = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+            return _mm256_cvttps_epi32(_mm256_mul_ps(a, _mm256_mul_ps(_mm256_set1_ps(c.magic_number), y)));
+        }
+    };
+}
+
+// a / b at [b * 256 + a], shared by every candidate
+const std::vector<int32_t>& u8_quotients() {
+    static const std::vector<int32_t> table = [] {
+        std::vector<int32_t> q(256 * 256, 0);
+        for (int b = 1; b < 256; b++) {
+            for (int a = 0; a < 256; a++) {
+                q[b * 256 + a] = a / b;
+            }
+        }
+        return q;
+    }();
+    return table;
+}
+
+// Every a in [0, 255] against every b in [1, 255]. test_u8_divide's
+// b = 256 wraps to 0 in correct_int_divide, so it has no right answer.
+// Both return on the first mismatch, most candidates fail within a few
+// divisors.
+template<typename Family>
+bool scalar_divide_passes(const divide_constants& c) {
+    const int32_t *quotients = u8_quotients().data();
+    for (int b = 1; b < 256; b++) {
+        for (int a = 0; a < 256; a++) {
+            if (Family::scalar(a, b, c) != quotients[b * 256 + a]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Family>
+FAST_TARGET_AVX2 bool avx2_divide_passes(const divide_constants& c) {
+    const int32_t *quotients = u8_quotients().data();
+    const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int b = 1; b < 256; b++) {
+        const __m256 vb = _mm256_set1_ps(static_cast<float>(b));
+        for (int a = 0; a < 256; a += 8) {
+            __m256i q = Family::avx2(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(a)), lane), vb, c);
+            __m256i expected = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(quotients + b * 256 + a));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(q, expected)) != -1) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct divide_candidate_result {
+    size_t index; // into the candidate list
+    bool avx2;    // the AVX2 form is exact too
+};
+
+// Every candidate the divide hack itself gets exact, in candidate order.
+// Candidates are split into blocks across the pool, each block keeps its
+// own list so there is nothing to lock.
+template<typename Family>
+std::vector<divide_candidate_result> search_divide_constants(const std::vector<divide_constants>& candidates,
+                                                             fast::thread_pool& pool = fast::thread_pool::global()) {
+    const size_t block = 1024;
+    const bool has_avx2 = fast::isa_supported(fast::isa::avx2);
+    std::vector<std::vector<divide_candidate_result>> passing((candidates.size() + block - 1) / block);
+    pool.parallel_for(passing.size(), [&](size_t task) {
+        const size_t end = std::min(candidates.size(), (task + 1) * block);
+        for (size_t i = task * block; i < end; i++) {
+            if (scalar_divide_passes<Family>(candidates[i])) {
+                passing[task].push_back({i, has_avx2 && avx2_divide_passes<Family>(candidates[i])});
+            }
+        }
+    });
+
+    std::vector<divide_candidate_result> result;
+    for (const auto& list : passing) {
+        result.insert(result.end(), list.begin(), list.end());
+    }
+    return result;
+}
+
+// Nanoseconds per divide of the scalar and (if asked) the AVX2 form over
+// all pairs
+template<typename Family>
+void time_divide_family(const divide_constants& c, bool time_avx2, double& scalar_ns, double& avx2_ns) {
+    const int rounds = 4;
+    volatile int sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        sink = sink + scalar_divide_passes<Family>(c);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds && time_avx2; r++) {
+        sink = sink + avx2_divide_passes<Family>(c);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    const double divides = double(rounds) * 255 * 256;
+    scalar_ns = std::chrono::duration<double, std::nano>(middle - start).count() / divides;
+    avx2_ns = std::chrono::duration<double, std::nano>(end - middle).count() / divides;
+}
+
+// Prints the passing set as runs of consecutive candidates, which share
+// scalar and magic_number and step through magic_mask, so every run lists
+// exactly its members. Each run's first candidate is timed in both forms
+// to name the faster one, the AVX2 form only counts if it was exact for
+// the whole run.
+template<typename Family>
+void report_divide_search(const std::vector<divide_constants>& candidates) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<divide_candidate_result> passing = search_divide_constants<Family>(candidates);
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    std::cout << Family::name << ": " << passing.size() << " of " << candidates.size()
+        << " candidates divide exactly (" << std::setprecision(3) << seconds.count() << " s)\n";
+    for (size_t i = 0; i < passing.size();) {
+        const divide_constants& first = candidates[passing[i].index];
+        size_t j = i;
+        bool avx2 = passing[i].avx2;
+        while (j + 1 < passing.size() && passing[j + 1].index == passing[j].index + 1
+               && candidates[passing[j + 1].index].magic_number == first.magic_number
+               && candidates[passing[j + 1].index].scalar == first.scalar) {
+            j++;
+            avx2 = avx2 && passing[j].avx2;
+        }
+        const divide_constants& last = candidates[passing[j].index];
+
+        std::cout << std::setprecision(9) << "  scalar=" << first.scalar
+            << " magic_number=" << first.magic_number << std::hex
+            << " magic_mask=0x" << first.magic_mask << "..0x" << last.magic_mask;
+        if (j > i) {
+            std::cout << " step 0x" << candidates[passing[i].index + 1].magic_mask - first.magic_mask;
+        }
+        std::cout << std::dec << " (" << j - i + 1 << ")";
+
+        double scalar_ns, avx2_ns;
+        time_divide_family<Family>(first, avx2, scalar_ns, avx2_ns);
+        const bool avx2_fastest = avx2 && avx2_ns < scalar_ns;
+        std::cout << std::setprecision(3) << " fastest: " << (avx2_fastest ? "avx2" : "scalar")
+            << " (scalar " << scalar_ns << " ns";
+        if (avx2) {
+            std::cout << ", avx2 " << avx2_ns << " ns";
+        } else if (fast::isa_supported(fast::isa::avx2)) {
+            std::cout << ", avx2 not exact";
+        }
+        std::cout << " per divide)\n";
+        i = j + 1;
+    }
+}
+
+// Candidate grids: scalar continues the old scalar += 0.01f walk, the
+// masks are a window around 0x7eb504f3 crossed with magic_number steps
+std::vector<divide_constants> scalar_candidates() {
+    std::vector<divide_constants> candidates;
+    float value = 1.0f;
+    for (int i = 0; i < (1 << 16); i++, value += 0.01f) {
+        candidates.push_back({value, magic_mask, magic_number});
+    }
+    return candidates;
+}
+
+std::vector<divide_constants> mask_candidates(float number_lo, float number_step, int numbers,
+                                              uint32_t mask_radius, uint32_t mask_step) {
+    std::vector<divide_constants> candidates;
+    for (int k = 0; k < numbers; k++) {
+        const float number = number_lo + k * number_step;
+        for (uint32_t mask = 0x7eb504f3 - mask_radius; mask <= 0x7eb504f3 + mask_radius; mask += mask_step) {
+            candidates.push_back({scalar, mask, number});
+        }
+    }
+    return candidates;
+}
+
+void search_u8_divide_constants() {
+    report_divide_search<divide_family::newton>(scalar_candidates());
+    report_divide_search<divide_family::magic_reciprocal>(mask_candidates(1.30f, 0.001f, 200, 1 << 16, 16));
+    report_divide_search<divide_family::refined_reciprocal>(mask_candidates(0.9990f, 0.0001f, 51, 1 << 20, 256));
+}
+
 int main()
 {
 	size_t height = 160;
@@ -149,24 +543,13 @@ int main()
 	std::function<float(float)> functions[] = {tg, fg};
 
 	graphs::functions(height, width, xmin, xmax, ymin, ymax, 2, functions);
-    size_t iterations = 0;
-    size_t failures = 0;
-    size_t min = 256*256;
-    while((failures = test_u8_divide()) > 0) {
-        if(!(iterations % 1000)) {
-            std::cout << "Trying " << std::setprecision(15) << std::hex <<scalar << std::dec << "\n";
-            std::cout << "Failures: " << failures << "\n";
-            std::cout << "Min: " << min << "\n";
-        }
-
-        // if(failures < min) {
-        //     std::cout << "New min: " << std::setprecision(15) << magic_mask << " Failures: " << failures << std::dec << "\n";
-        //     min = failures;
-        // }
-        iterations++;
-        scalar += 0.01f;
-        //approx_magic_number = std::nextafter(approx_magic_number, -std::numeric_limits<float>::infinity());
-    }
-    std::cout << "Failures: " << test_u8_divide() << " with magic_scale2: " << std::setprecision(15) << magic_scale2 << "\n";
+    std::cout << "AVX2 u8 divide failures: " << test_avx2_u8_divide() << "\n";
+    std::cout << "divider_u8 failures: " << test_divider_u8() << "\n";
+    std::cout << "u16 divide failures: " << verify_u16_divide() << "\n";
+    std::cout << "u32 divide failures: " << test_u32_divide() << "\n";
+    std::cout << "RGBA8 divide failures: " << test_rgba8_divide() << "\n";
+
+    std::cout << "magic_divide failures: " << test_u8_divide() << "\n";
+    search_u8_divide_constants();
 	return 0;
 }